@@ -2,11 +2,13 @@
 
 #include <array>
 #include <string>
+#include <vector>
 
 #include "Constants.h" 
 #include "Tetrimino.h"
 
 class Board;
+struct PlacementBatch;
 
 typedef std::array<WidthInt, BLOCKS_H> board_t;
 typedef std::pair<Board, Tetrimino> Context;
@@ -14,17 +16,22 @@ typedef std::pair<Board, Tetrimino> Context;
 class Board
 {    
     void SetScore(const int& destroyedLines, const int& dropHeight, const int& tetriminoRotationHeight);
-    double CalculateScore(const int& destroyedLines, const int& dropHeight, const int& tetriminoRotationHeight) const;
-    double BestSubScore(const int& currentDepth, const int& maxDepth, const std::deque<int>& tetriminoQueue) const;
+    score_t BestSubScore(const int& currentDepth, const int& maxDepth, const std::deque<int>& tetriminoQueue) const;
     int DropTetriminoRotation(const TetriminoRotation& tr);
     int DestroyLines(const int& dropHeight, const int& trHeight);
+    //same as DestroyLines, all the full rows are removed in a single pass
+    int CompactLines(const int& dropHeight, const int& trHeight);
+    void PlaceTetriminoRotation(const TetriminoRotation& tr, const int& column, const int& height);
 
 public:
-    double score;
+    score_t score;
     board_t boardArr;
 
     Board();
     void Reset();
+    //false if score is one of the SCORE_INVALID or SCORE_GAME_OVER states
+    static bool IsPlayable(const score_t& score);
+    score_t CalculateScore(const int& destroyedLines, const int& dropHeight, const int& tetriminoRotationHeight) const;
 
     //drops the tetrimino and invoke scopeCalculator, which will modify the best value
     //scopeCalculator must be a lambda which captures the best value to modify
@@ -39,10 +46,18 @@ public:
         }
     }
 
+    //resting positions of tr reachable from the top by moving left, right and down, slides under overhangs included
+    //bit (MAX_WIDTH - 1 - column) of resting[height] is set if tr can rest with its top row on row height, shifted by column
+    void ReachablePlacements(const TetriminoRotation& tr, board_t& resting) const;
+
+    //fills batch with the resulting board of every reachable placement of every rotation of tetrimino
+    //placements are ordered by rotation, then height, then column from the right
+    void Placements(const Tetrimino& tetrimino, PlacementBatch& batch) const;
+
     //top level score calculator
     void ResursiveScoreCalculator(const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr, Board& best, const std::deque<int>& tetriminoQueue) const;
     //nested score calculator called if recursion level > 1
-    void SubScoreCalculator(const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr, double& best, const int& currentDepth, const int& maxDepth, const std::deque<int>& tetriminoQueue) const;
+    void SubScoreCalculator(const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr, score_t& best, const int& currentDepth, const int& maxDepth, const std::deque<int>& tetriminoQueue) const;
     std::string Serialize() const;
     void Print(int spaces = 10) const;
 
@@ -50,4 +65,26 @@ public:
 
     friend bool operator==(const Board& lhs, const Board& rhs);
     friend std::size_t hash_value(const Board& board);
+};
+
+//children of a board for one tetrimino, entry i of every array belongs to the same placement
+//the arrays only grow, a batch reused for every node stops allocating once it has seen the largest piece
+struct PlacementBatch
+{
+    size_t size = 0;
+    std::vector<Board> boards;
+    std::vector<int> dropHeights;
+    std::vector<int> destroyedLines;
+    std::vector<int> trHeights;
+
+    void Reserve(const size_t& count)
+    {
+        if(boards.size() < count)
+        {
+            boards.resize(count);
+            dropHeights.resize(count);
+            destroyedLines.resize(count);
+            trHeights.resize(count);
+        }
+    }
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "Constants.h"
+#include "Board.h"
+#include "SearchTree.h"
+#include "RolloutSearch.h"
+
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t blocksW;
+    uint32_t blocksH;
+    uint32_t lookAhead;
+    uint32_t numPieces;
+    char evaluator[32];
+    //bytes of state after the header
+    uint64_t size;
+};
+
+//everything a game needs to carry on exactly where it stopped
+struct GameState
+{
+    Board board;
+    int hold = -1;
+    std::deque<int> tetriminoQueue;
+    int upcomingPiece = -1;
+    //engine states written with operator<<, searchRng is empty if the game has no rollout search
+    std::string rng;
+    std::string searchRng;
+
+    uint64_t deaths = 0;
+    uint64_t totalBlocks = 0;
+    double avgBlocksPerGame = 0;
+    double totalScore = 0;
+    uint64_t bookHits = 0;
+    RolloutStats rolloutStats;
+
+    //subtree retained by the lookahead search and the pieces it was expanded with
+    SearchNode treeRoot;
+    std::deque<int> treeQueue;
+};
+
+//binary snapshots of a GameState
+namespace Checkpoint
+{
+    //writes to fileName.tmp, syncs it then renames it over fileName so a crash never leaves a partial checkpoint
+    void Write(const std::string& fileName, const std::string& evaluator, const GameState& state);
+    //fatal if the checkpoint is damaged or was written with other constants or another evaluator
+    GameState Read(const std::string& fileName, const std::string& evaluator);
+}
\ No newline at end of file
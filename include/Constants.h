@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <limits>
 #include <math.h>
 #include <string>
 
@@ -10,11 +11,24 @@ const std::string BOARDS_LOG_DIR = LOGS_DIR + "boards/";
 const std::string CONTEXTS_LOG_DIR = LOGS_DIR + "contexts/";
 
 typedef std::uint32_t WidthInt;
+typedef std::int32_t score_t;//fixed point, SCORE_SCALE is 1
+const score_t SCORE_SCALE = 256;
+const score_t SCORE_INVALID = std::numeric_limits<score_t>::min();//not scored
+const score_t SCORE_GAME_OVER = SCORE_INVALID + 1;//no placement fits
 const int MAX_WIDTH = 32; 
 const int NUM_PIECES = 7;
 const int BLOCKS_W = 10;
 const int BLOCKS_H = 16;
 const int LOOK_AHEAD = 3;//must be 1 minimum, 1 means no lookahead, 2 looks 1 piece further than current
 const int NUM_WORKERS = 8;
+const int SPECULATION_WIDTH = 3;//number of candidate boards the next move is speculatively searched from
+const int BOOK_ROWS = 4;//boards with nothing above this row can be answered from the placement book
+const int BOOK_DEPTH = 3;//moves from the start of a game the placement book is generated for
+const int ROLLOUT_BUDGET = 512;//playouts per move in rollout mode, split between the root placements
+const int ROLLOUT_DEPTH = 8;//pieces placed by each playout after the root placement
+const score_t ROLLOUT_DEATH_SCORE = -1000 * SCORE_SCALE;//score of a playout that topped out
+const int FARM_BATCH_SEEDS = 2;//games handed to a farm worker at once, one per seed
+const double FARM_SLOW_FACTOR = 3;//a farm batch running this many times longer than the average batch is also given to another worker
+const double SPECULATION_START = 0.5;//fraction of root placements searched before speculating
 
 const WidthInt FULL_LINE = (~(WidthInt(0))) ^ (WidthInt)(pow(2, MAX_WIDTH - BLOCKS_W) - 1);
\ No newline at end of file
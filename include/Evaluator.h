@@ -0,0 +1,251 @@
+#pragma once
+
+#include <ratio>
+
+#include "Constants.h"
+#include "Board.h"
+
+//feature kernels of the leaf evaluation, they live in this header so each evaluator gets them inlined
+
+inline int getRowTransitions(const Board& board)
+{
+	int transitions = 0;
+	bool last_bit = 1;
+	bool bit;
+
+	for (int i = 0; i <= BLOCKS_H - 1; i++)
+	{
+		WidthInt row = board.boardArr[i];
+
+		for (int j = 0; j < BLOCKS_W; j++)
+		{
+			bit = (row >> (MAX_WIDTH - BLOCKS_W + j)) & (WidthInt)1;
+
+			if (bit != last_bit)
+				++transitions;
+
+			last_bit = bit;
+		}
+		if (bit == 0)
+			++transitions;
+		last_bit = 1;
+	}
+	return transitions;
+}
+
+inline int getColumnTransitions(const Board& board)
+{
+	int transitions = 0;
+	bool last_bit = 1;
+    int startingHeight = BLOCKS_H -1;
+
+	for (int i = 0; i < BLOCKS_W; ++i) {
+		for (int j = 0; j <= startingHeight; ++j) {
+			WidthInt row = board.boardArr[j];
+			bool bit = (row >> (MAX_WIDTH - BLOCKS_W + i)) & (WidthInt)1;
+
+			if (bit != last_bit) {
+				++transitions;
+			}
+
+			last_bit = bit;
+		}
+
+		last_bit = 1;
+	}
+
+	return transitions;
+}
+
+inline int getNumberOfHoles(const Board& board) {
+	int holes = 0;
+	WidthInt row_holes = 0;
+    int startingHeight = BLOCKS_H - 1;
+	WidthInt previous_row = board.boardArr[startingHeight];
+
+	for (int i = startingHeight - 1; i >= 0; --i) {
+		row_holes = ~board.boardArr[i] & (previous_row | row_holes);
+
+		for (int j = 0; j < BLOCKS_W; ++j) {
+			holes += ((row_holes >> (MAX_WIDTH - BLOCKS_W + j)) & (WidthInt)1);
+		}
+
+		previous_row = board.boardArr[i];
+	}
+
+	return holes;
+}
+
+
+inline int getWellSums(const Board& board) {
+	int well_sums = 0;
+
+	// Check for well cells in the "inner columns" of the board.
+	// "Inner columns" are the columns that aren't touching the edge of the board.
+    int startingHeight = BLOCKS_H - 1;
+
+	for (int i = 1; i < BLOCKS_W - 1; ++i) {
+		for (int j = startingHeight; j >= 0; --j) {
+			if (((board.boardArr[j] >> (MAX_WIDTH - BLOCKS_W + i - 1)) & (WidthInt)7) == (WidthInt)5) {
+
+				// Found well cell, count it + the number of empty cells below it.
+				++well_sums;
+				
+				for (int k = j - 1; k >= 0; --k) {
+					if (((board.boardArr[k] >> (MAX_WIDTH - BLOCKS_W + i)) & (WidthInt)1) == (WidthInt)0) {
+						++well_sums;
+					}
+					else {
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// Check for well cells in the leftmost column of the board.
+	for (int j = startingHeight; j >= 0; --j) {
+		if (((board.boardArr[j] >> (MAX_WIDTH - BLOCKS_W)) & (WidthInt)3) == (WidthInt)2) {
+
+			// Found well cell, count it + the number of empty cells below it.
+			++well_sums;
+
+			for (int k = j - 1; k >= 0; --k) {
+				if (((board.boardArr[k] >> (MAX_WIDTH - BLOCKS_W)) & (WidthInt)1) == (WidthInt)0) {
+					++well_sums;
+				}
+				else {
+					break;
+				}
+			}
+		}
+	}
+
+	// Check for well cells in the rightmost column of the board.
+	for (int j = startingHeight; j >= 0; --j) {
+		if (((board.boardArr[j] >> (MAX_WIDTH-2)) & (WidthInt)3) == (WidthInt)1) {
+			// Found well cell, count it + the number of empty cells below it.
+
+			++well_sums;
+			for (int k = j - 1; k >= 0; --k) {
+				if (((board.boardArr[k] >> (MAX_WIDTH - 1)) & (WidthInt)1) == (WidthInt)0) {
+					++well_sums;
+				}
+				else {
+					break;
+				}
+			}
+		}
+	}
+
+	return well_sums;
+}
+
+namespace Features
+{
+    struct AdjustedDropHeight
+    {
+        static int Compute(const Board&, const int&, const int& dropHeight, const int& trHeight)
+        {
+            return dropHeight + ((trHeight - 1)/2);
+        }
+    };
+
+    struct DestroyedLines
+    {
+        static int Compute(const Board&, const int& destroyedLines, const int&, const int&)
+        {
+            return destroyedLines;
+        }
+    };
+
+    struct RowTransitions
+    {
+        static int Compute(const Board& board, const int&, const int&, const int&)
+        {
+            return getRowTransitions(board);
+        }
+    };
+
+    struct ColumnTransitions
+    {
+        static int Compute(const Board& board, const int&, const int&, const int&)
+        {
+            return getColumnTransitions(board);
+        }
+    };
+
+    struct Holes
+    {
+        static int Compute(const Board& board, const int&, const int&, const int&)
+        {
+            return getNumberOfHoles(board);
+        }
+    };
+
+    struct WellSums
+    {
+        static int Compute(const Board& board, const int&, const int&, const int&)
+        {
+            return getWellSums(board);
+        }
+    };
+}
+
+//feature weighted by a std::ratio, a zero weight compiles the feature out
+//the weight is rounded to a fixed point score_t at compile time
+template <typename Feature, typename Weight>
+struct Term
+{
+    static constexpr std::intmax_t scaled = Weight::num * SCORE_SCALE;
+    static constexpr score_t weight = (scaled >= 0 ? scaled + Weight::den / 2 : scaled - Weight::den / 2) / Weight::den;
+
+    static score_t Score(const Board& board, const int& destroyedLines, const int& dropHeight, const int& trHeight)
+    {
+        if constexpr (weight == 0)
+            return 0;
+        else
+            return Feature::Compute(board, destroyedLines, dropHeight, trHeight) * weight;
+    }
+};
+
+//leaf evaluation function made of weighted features, used as a template parameter of the search
+template <typename... Terms>
+struct Evaluator
+{
+    static score_t Score(const Board& board, const int& destroyedLines, const int& dropHeight, const int& trHeight)
+    {
+        return (score_t(0) + ... + Terms::Score(board, destroyedLines, dropHeight, trHeight));
+    }
+};
+
+typedef std::ratio<-4500158825082766, 1000000000000000> DropHeightWeight;
+typedef std::ratio<3418126810139269, 1000000000000000> DestroyedLinesWeight;
+typedef std::ratio<-3217888286848775, 1000000000000000> RowTransitionsWeight;
+typedef std::ratio<-9348695305445199, 1000000000000000> ColumnTransitionsWeight;
+typedef std::ratio<-7899265427351652, 1000000000000000> HolesWeight;
+typedef std::ratio<-3385597224726363, 1000000000000000> WellSumsWeight;
+
+//El-Tetris features and weights
+typedef Evaluator<
+    Term<Features::AdjustedDropHeight, DropHeightWeight>,
+    Term<Features::DestroyedLines, DestroyedLinesWeight>,
+    Term<Features::RowTransitions, RowTransitionsWeight>,
+    Term<Features::ColumnTransitions, ColumnTransitionsWeight>,
+    Term<Features::Holes, HolesWeight>,
+    Term<Features::WellSums, WellSumsWeight>> DefaultEvaluator;
+
+//El-Tetris without the well sums
+typedef Evaluator<
+    Term<Features::AdjustedDropHeight, DropHeightWeight>,
+    Term<Features::DestroyedLines, DestroyedLinesWeight>,
+    Term<Features::RowTransitions, RowTransitionsWeight>,
+    Term<Features::ColumnTransitions, ColumnTransitionsWeight>,
+    Term<Features::Holes, HolesWeight>,
+    Term<Features::WellSums, std::ratio<0>>> NoWellsEvaluator;
+
+//El-Tetris without the row and column transitions and the well sums, holes is the only feature left that scans the board
+typedef Evaluator<
+    Term<Features::AdjustedDropHeight, DropHeightWeight>,
+    Term<Features::DestroyedLines, DestroyedLinesWeight>,
+    Term<Features::Holes, HolesWeight>> FastEvaluator;
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "Game.h"
+
+//self-play spread over worker processes, each game is --moves moves of one seed
+//coordinator and workers exchange text lines over TCP so workers can also be started by hand, on other machines later:
+//  worker      HELLO <pid>
+//  coordinator CONFIG <moves> <pipelined> <rollouts> <trace> <evaluator> <book, - if none>
+//  coordinator BATCH <batch> <first seed> <number of seeds>
+//  worker      RESULT <batch> <seed> <deaths> <total blocks> <book hits> <total score>
+//  worker      TRACE <batch> <size>, then size bytes of Chrome trace JSON
+//  worker      DONE <batch>
+//  coordinator QUIT
+
+//settings every farm game is played with
+struct FarmConfig
+{
+    GameOptions options;
+    uint64_t moves = 0;
+    bool trace = false;
+};
+
+//statistics of the game of one seed
+struct FarmResult
+{
+    uint64_t seed = 0;
+    GameStatistics statistics;
+};
+
+class FarmCoordinator
+{
+    struct Batch
+    {
+        uint64_t firstSeed;
+        uint64_t numSeeds;
+        bool done = false;
+        //workers currently playing it, more than one once it was found slow
+        int running = 0;
+    };
+
+    struct Connection
+    {
+        int fd;
+        pid_t pid = 0;
+        std::string input;
+        //batch being played, -1 if idle
+        int batch = -1;
+        std::chrono::steady_clock::time_point started;
+        std::vector<FarmResult> results;
+        std::string trace;
+    };
+
+    FarmConfig config;
+    std::string traceFile;
+    int listenFd;
+    uint16_t port;
+    std::vector<Batch> batches;
+    std::deque<int> pending;
+    std::vector<Connection> connections;
+    std::vector<pid_t> children;
+    uint respawns;
+    size_t batchesDone;
+    double batchSeconds;
+    std::vector<FarmResult> results;
+
+    void Spawn();
+    void Reap();
+    void Accept();
+    //false once the worker is gone
+    bool Receive(Connection& connection);
+    bool Handle(Connection& connection, const std::string& line);
+    void Drop(Connection& connection);
+    void Assign(Connection& connection);
+    void Finish(Connection& connection);
+    void Send(Connection& connection, const std::string& line);
+
+public:
+    //listens on port of the loopback interface, any free port if 0
+    FarmCoordinator(const FarmConfig& config, const uint16_t& port, const std::string& traceFile);
+    ~FarmCoordinator();
+    FarmCoordinator(const FarmCoordinator&) = delete;
+    FarmCoordinator& operator=(const FarmCoordinator&) = delete;
+
+    //spawns numWorkers workers and plays numGames seeds from firstSeed, batches of workers that die or stall are handed to others
+    //returns the results ordered by seed, traces are written to traceFile.<first seed of the batch>
+    std::vector<FarmResult> Run(const uint64_t& firstSeed, const uint64_t& numGames, const uint& numWorkers);
+};
+
+//connects to the coordinator at host:port and plays the batches it is given until it says QUIT
+void RunFarmWorker(const std::string& address);
\ No newline at end of file
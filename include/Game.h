@@ -13,53 +13,96 @@
 #include "Constants.h"
 #include "Tetrimino.h"
 #include "Board.h"
+#include "SearchTree.h"
+#include "SpeculativeSearch.h"
+#include "PlacementBook.h"
+#include "RolloutSearch.h"
+#include "Checkpoint.h"
 
-typedef std::pair<board_t, double> boardAndScore_t;
+typedef std::pair<board_t, score_t> boardAndScore_t;
 
-struct CacheHash
+class FindBestBoard_Rec_Channels;
+
+struct GameOptions
 {
-    std::size_t operator()(const std::pair<Board, int>& key) const
-    {
-        boost::hash<std::pair<Board, int>> boardHash;
-        return boardHash(key);
-    }
+    //search the next move from the best candidates while the current one is still being searched
+    bool pipelined = false;
+    //name of one of SearchTree::evaluators
+    std::string evaluator = SearchTree::evaluators.front().name;
+    //placement book to answer low positions from, none if empty
+    std::string book;
+    //seed of the piece generator, 0 for a random one
+    uint64_t seed = 0;
+    //decide moves with RolloutSearch instead of the lookahead search
+    bool rollouts = false;
+    //file the game state is saved to every checkpointEvery moves, none if empty
+    std::string checkpoint;
+    uint64_t checkpointEvery = 0;
+    //checkpoint the game starts from, a new game if empty
+    std::string resume;
 };
 
-class FindBestBoard_Rec_Channels;
+struct GameStatistics
+{
+    uint64_t deaths = 0;
+    uint64_t totalBlocks = 0;
+    uint64_t bookHits = 0;
+    //sum of the scores of the boards played, in score units
+    double totalScore = 0;
+};
 
 class Game
 {
     std::unique_ptr<std::mt19937> rng;
     std::unique_ptr<std::uniform_int_distribution<std::mt19937::result_type>> dist;
     std::deque<int> tetriminoQueue;
-    std::unordered_map<std::pair<Board, int>, Board, CacheHash> bestBoardCache;
+    //piece drawn ahead of time for speculation, -1 if none
+    int upcomingPiece;
+    GameOptions options;
+    SpeculativeSearch speculativeSearch;
+    //held tetrimino, -1 if the hold slot is empty
+    int hold;
+    PlacementBook book;
+    //checkpoint being written in the background
+    std::future<void> pendingCheckpoint;
     
     //statistics stuff
     uint64_t deaths;
     uint64_t totalBlocks;
     double avgBlocksPerGame;
     double totalScore;
+    uint64_t bookHits;
     Board board;
 
-    void UpdateBoard(Board&& board);
+    void UpdateBoard(SearchResult&& result);
     void ResetBoard();
-    void CheckGameOver(const double& score);
+    void CheckGameOver(const score_t& score);
     void UpdateQueue();
+    std::deque<int> NextQueue();
+    void Speculate(const std::vector<SearchNode>& candidates);
+    bool TakeSpeculation(SearchResult& best);
     void PrintFPS() const;
-    void PrintStatistics() const;
+    GameState Snapshot() const;
+    void Restore(GameState&& state);
 
     static std::vector<Tetrimino> LoadTetriminos();
 
 public:
     static const std::vector<Tetrimino> tetriminos;
 
-    Game();
+    Game(const GameOptions& options = GameOptions());
     Board FindBestBoard_SingleThread() const;
     Board FindBestBoard_MultiThread() const;
-    //ptr to functor
+    //ptr to functor, null in rollout mode
     std::unique_ptr<FindBestBoard_Rec_Channels> findBestBoard_Rec_Channels;
+    std::unique_ptr<RolloutSearch> rolloutSearch;
     
     void Update();
+    void PrintStatistics() const;
+    GameStatistics Statistics() const;
+    //writes options.checkpoint in the background, skipped if the previous one is still being written unless wait is set
+    //with wait it returns once the checkpoint is on disk
+    void SaveCheckpoint(const bool& wait = false);
     void DebugContext(const Context&);
     
     static void Log(const Context&);
@@ -69,16 +112,35 @@ public:
     static Context LoadContextFromFile(const std::string& fileName, const std::vector<Tetrimino>& tetriminos);
 };
 
+//root child for a search worker to score, of the tree being searched unless speculation is set
+struct SearchJob
+{
+    size_t childIndex;
+    std::shared_ptr<Speculation> speculation;
+};
+
 class FindBestBoard_Rec_Channels
 {
     static const size_t chanSize = 512;
     FindBestBoard_Rec_Channels() = delete;
-    boost::fibers::buffered_channel<std::tuple<Board, TetriminoRotation, std::deque<int>>> argsChan{chanSize};
-    boost::fibers::buffered_channel<Board> resultChan{chanSize};
+    //workers send back the index and score of the root children of tree, speculations collect their own scores
+    //the results of a search always fit in resultChan, so workers never block and a full argsChan only delays a push
+    boost::fibers::buffered_channel<SearchJob> argsChan{chanSize};
+    boost::fibers::buffered_channel<std::pair<size_t, score_t>> resultChan{chanSize};
     std::vector<std::future<void>> workers;
+    SearchTree tree;
+    std::deque<int> searchQueue;
 
 public:
     uint numWorkers;
     FindBestBoard_Rec_Channels(const uint& workers);
-    Board operator()(const Board& board, const std::deque<int>& tetriminoQueue);
+    ~FindBestBoard_Rec_Channels();
+    //onCandidates gets the best root children once SPECULATION_START of them have been searched
+    SearchResult operator()(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue,
+        const std::function<void(const std::vector<SearchNode>&)>& onCandidates = nullptr);
+    //queues the root children of a prepared speculative search behind the jobs already queued
+    void Dispatch(const std::shared_ptr<Speculation>& speculation);
+    void Adopt(SearchTree&& tree);
+    const SearchTree& Tree() const;
+    void SetEvaluator(const std::string& name);
 };
\ No newline at end of file
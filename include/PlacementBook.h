@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Constants.h"
+#include "Board.h"
+#include "SearchTree.h"
+
+//rows a placement can reach above a book board
+const int BOOK_RESULT_ROWS = BOOK_ROWS + 4;
+
+struct BookHeader
+{
+    char magic[8];
+    uint32_t blocksW;
+    uint32_t blocksH;
+    uint32_t bookRows;
+    uint32_t lookAhead;
+    char evaluator[32];
+    uint64_t numEntries;
+};
+
+//best placement for a low board, hold and queue, rows are stored without the unused low bits
+struct BookEntry
+{
+    uint64_t key;
+    uint16_t rows[BOOK_RESULT_ROWS];
+    score_t score;
+    uint32_t swapped;
+};
+
+//table of best placements for boards with nothing above BOOK_ROWS, sorted by key and memory mapped
+//generated offline from the positions that open every game, so those moves don't need a search
+class PlacementBook
+{
+    int fd;
+    size_t mappedSize;
+    const void* mapped;
+    const BookEntry* entries;
+    size_t numEntries;
+
+    static const char magic[8];
+
+public:
+    PlacementBook();
+    ~PlacementBook();
+    PlacementBook(const PlacementBook&) = delete;
+    PlacementBook& operator=(const PlacementBook&) = delete;
+
+    //maps the book, fatal if it was built for another board size, lookahead or evaluator
+    void Open(const std::string& fileName, const std::string& evaluator);
+    bool IsOpen() const;
+    size_t Size() const;
+    //fills result with the book placement if the position is in the book
+    bool Find(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue, SearchResult& result) const;
+
+    //false if board has something above BOOK_ROWS
+    static bool Key(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue, uint64_t& key);
+    //false if the position can't go in the book
+    static bool MakeEntry(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue, const SearchResult& result, BookEntry& entry);
+    //searches every position the lookahead search reaches in the first BOOK_DEPTH moves of a game, for every queue
+    //a game starts on an empty board with an empty hold slot, then each placement can be followed by any new pieces
+    static std::vector<BookEntry> Generate(const std::string& evaluator);
+    //sorts entries, keeps the first entry of each key and writes the book atomically, returns the number of positions written
+    static size_t Write(const std::string& fileName, const std::string& evaluator, std::vector<BookEntry> entries);
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <random>
+#include <utility>
+#include <vector>
+#include <boost/fiber/all.hpp>
+
+#include "Constants.h"
+#include "Board.h"
+#include "SearchTree.h"
+
+//outcome of the playouts of one root placement
+struct RolloutStats
+{
+    uint64_t playouts = 0;
+    uint64_t survived = 0;
+    uint64_t lines = 0;
+    //sum of the playout scores, ROLLOUT_DEATH_SCORE for the ones that died
+    int64_t scoreSum = 0;
+};
+
+//decides a move by playing ROLLOUT_BUDGET short random games from the root placements instead of searching the preview
+//playouts place each piece greedily with Board::CalculateScore, they use the known queue then random pieces
+//the placement whose playouts survived most often is played, the mean playout score breaks ties
+class RolloutSearch
+{
+    struct Job
+    {
+        size_t childIndex;
+        uint64_t playouts;
+        uint64_t seed;
+    };
+
+    static const size_t chanSize = 512;
+    RolloutSearch() = delete;
+    boost::fibers::buffered_channel<Job> argsChan{chanSize};
+    boost::fibers::buffered_channel<std::pair<size_t, RolloutStats>> resultChan{chanSize};
+    std::vector<std::future<void>> workers;
+    SearchTree tree;
+    std::deque<int> searchQueue;
+    std::mt19937_64 seeder;
+    //sum of the stats of the placements played
+    RolloutStats chosen;
+
+    RolloutStats Playouts(const SearchNode& child, const uint64_t& playouts, const uint64_t& seed) const;
+    static score_t Mean(const RolloutStats& stats);
+    //higher survival rate first, then SearchTree::IsBetter on the mean scores
+    static bool IsBetter(const RolloutStats& stats, const size_t& index, const RolloutStats& best, const size_t& bestIndex);
+
+public:
+    RolloutSearch(const uint& numWorkers, const uint64_t& seed);
+    ~RolloutSearch();
+    SearchResult operator()(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue);
+    //state of the generator of the playout seeds, written with operator<<
+    std::string RngState() const;
+    void SetRngState(const std::string& state);
+    const RolloutStats& Chosen() const;
+    void SetChosen(const RolloutStats& stats);
+};
\ No newline at end of file
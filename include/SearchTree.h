@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/functional/hash.hpp>
+
+#include "Constants.h"
+#include "Board.h"
+
+struct CacheHash
+{
+    std::size_t operator()(const std::pair<Board, int>& key) const
+    {
+        boost::hash<std::pair<Board, int>> boardHash;
+        return boardHash(key);
+    }
+};
+
+//board reached by placing a tetrimino, with the placements of the next piece once expanded
+struct SearchNode
+{
+    Board board;
+    int destroyedLines = 0;
+    int dropHeight = 0;
+    int trHeight = 0;
+    //held tetrimino after the placement, -1 if the hold slot is empty
+    int hold = -1;
+    //queue pieces used by the placement, 2 when the hold slot was empty and the current piece went into it
+    int consumed = 1;
+    //the placements of the current piece were added as children
+    //placements reaching the end of the queue are leaves, they are only kept as children of the root
+    bool expanded = false;
+    //the hold placements were added too, they wait for the next piece when the hold slot is empty and it isn't revealed yet
+    bool holdExpanded = false;
+    std::vector<SearchNode> children;
+};
+
+//placement chosen by a search
+struct SearchResult
+{
+    Board board;
+    int hold = -1;
+    int consumed = 1;
+};
+
+//scores of the nodes already searched during the current search, shared by all the workers
+//holding creates the same board and hold reached in different orders, those subtrees are only searched once
+class TranspositionTable
+{
+    static const size_t numShards = 64;
+    std::array<std::mutex, numShards> locks;
+    std::array<std::unordered_map<std::pair<Board, int>, score_t, CacheHash>, numShards> shards;
+
+public:
+    bool Find(const std::pair<Board, int>& key, score_t& score);
+    void Insert(const std::pair<Board, int>& key, const score_t& score);
+    void Clear();
+};
+
+class SearchTree;
+
+typedef score_t (SearchTree::*EvaluateFunction)(SearchNode&, const int&, const std::deque<int>&);
+
+//search specialized for one of the evaluators of Evaluator.h
+struct EvaluatorEntry
+{
+    std::string name;
+    EvaluateFunction evaluate;
+};
+
+//lookahead tree kept alive between moves
+//after a move is chosen only the subtree under the chosen placement is kept, so the next search
+//only has to expand the piece that was just revealed at the deepest level
+class SearchTree
+{
+    SearchNode root;
+    //pieces the retained nodes were expanded with, front is the piece placed from root
+    std::deque<int> expandedQueue;
+    std::unique_ptr<TranspositionTable> table = std::make_unique<TranspositionTable>();
+    EvaluateFunction evaluate;
+
+    static void AddPlacements(SearchNode& node, const int& tetriminoIndex, const int& hold, const int& consumed);
+    //piece placed by swapping with the hold slot of node and the queue pieces it uses, false if there is no such placement yet
+    static bool HoldPlacement(const SearchNode& node, const int& queueIndex, const std::deque<int>& tetriminoQueue, int& piece, int& consumed);
+    //placements of the current piece, and of the held one swapped with it, leaves are only added if leaves is set
+    //a node expanded before the piece it would hold for was revealed gets its hold placements once it is
+    static void Expand(SearchNode& node, const int& queueIndex, const std::deque<int>& tetriminoQueue, const bool& leaves);
+
+    //best score of the placements of a piece on board, scored from a PlacementBatch without building their nodes
+    template <typename Evaluator>
+    static score_t BestLeaf(const Board& board, const int& tetriminoIndex);
+
+    template <typename Evaluator>
+    score_t EvaluateWith(SearchNode& node, const int& queueIndex, const std::deque<int>& tetriminoQueue);
+
+public:
+    //prebuilt evaluators the search can be run with, the first one is the default
+    static const std::vector<EvaluatorEntry> evaluators;
+
+    SearchTree();
+    //fatal if name isn't in evaluators
+    void SetEvaluator(const std::string& name);
+
+    //reuses the retained subtree if it was built from board and hold with the same upcoming pieces, else starts over
+    void Prepare(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue);
+    std::vector<SearchNode>& RootChildren();
+    const SearchNode& Root() const;
+    const std::deque<int>& ExpandedQueue() const;
+    //keeps the subtree of the chosen root child as the root of the next search
+    void Retain(const size_t& childIndex);
+    //takes node as the retained root, its subtree having been expanded with expandedQueue
+    void Adopt(SearchNode&& node, const std::deque<int>& expandedQueue);
+    //copies of the count best scored root children with their subtrees
+    std::vector<SearchNode> TopChildren(std::vector<std::pair<score_t, size_t>> scores, const size_t& count) const;
+    SearchResult Result(const size_t& childIndex, const score_t& score) const;
+    //move order of the search: higher score first, lower root child index on ties so every run picks the same child
+    static bool IsBetter(const score_t& score, const size_t& index, const score_t& bestScore, const size_t& bestIndex);
+
+    //picks the best of the scored root children and retains it, scores holding the score and index of every root child
+    SearchResult Choose(const std::vector<std::pair<score_t, size_t>>& scores);
+
+    //best leaf score reachable from node, queueIndex being the number of queue pieces used to reach it
+    //safe to call concurrently on different root children
+    score_t Evaluate(SearchNode& node, const int& queueIndex, const std::deque<int>& tetriminoQueue);
+};
\ No newline at end of file
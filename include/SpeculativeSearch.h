@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Constants.h"
+#include "Board.h"
+#include "SearchTree.h"
+
+class FindBestBoard_Rec_Channels;
+
+struct SpeculationResult
+{
+    SearchResult best;
+    SearchTree tree;
+};
+
+//search of the next move from one candidate board, its root children are scored by the search workers
+struct Speculation
+{
+    Board board;
+    int hold;
+    std::deque<int> tetriminoQueue;
+    SearchTree tree;
+    //the root children still queued are skipped once set
+    std::atomic<bool> cancelled{false};
+    std::mutex lock;
+    std::condition_variable done;
+    //score and index of the root children scored so far
+    std::vector<std::pair<score_t, size_t>> scores;
+
+    //called by a search worker for each root child
+    void Score(const size_t& childIndex);
+    //returns the scores once count root children are scored
+    std::vector<std::pair<score_t, size_t>> Wait(const size_t& count);
+};
+
+//searches the next move from a few candidate boards while the current move is still being decided
+//only the speculation started from the board that actually gets played is kept
+class SpeculativeSearch
+{
+    std::vector<std::shared_ptr<Speculation>> speculations;
+    std::deque<int> speculatedQueue;
+
+public:
+    ~SpeculativeSearch();
+
+    //candidates are root children of a search done with parentQueue, each is searched with nextQueue by the workers of search
+    //their root children are queued behind the ones of the search running on them, so it isn't slowed down
+    void Launch(const std::vector<SearchNode>& candidates, const std::deque<int>& parentQueue, const std::deque<int>& nextQueue,
+        const std::string& evaluator, FindBestBoard_Rec_Channels& search);
+    //if board and hold were speculated with tetriminoQueue, waits for its result and drops the other speculations
+    //onCandidates gets its best root children once SPECULATION_START of them have been scored
+    bool Take(const Board& board, const int& hold, const std::deque<int>& tetriminoQueue, SpeculationResult& result,
+        const std::function<void(const std::vector<SearchNode>&)>& onCandidates);
+    //drops the speculations not started from board and hold, once the move they were started from is decided
+    void Keep(const Board& board, const int& hold);
+    void Cancel();
+};
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+//timeline of scoped events recorded per thread and exported in the Chrome trace event format (chrome://tracing, Perfetto)
+//when tracing isn't enabled a Scope only costs a relaxed load
+namespace Trace
+{
+    extern std::atomic<bool> enabled;
+
+    inline bool IsEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void Enable();
+    //nanoseconds since the trace epoch
+    int64_t Now();
+    //name must outlive the trace, string literals are expected
+    void Record(const char* name, const int64_t& arg, const int64_t& start, const int64_t& end);
+    //does nothing unless tracing is enabled, threads started before Enable keep their default name
+    void SetThreadName(const std::string& name);
+    //writes the events of every thread so far, fatal if the file can't be written
+    void Write(const std::string& fileName);
+    void Write(std::ostream& out);
+    //drops the events recorded so far and the buffers of the threads that ended
+    void Clear();
+
+    //records the time between its construction and its destruction, arg is exported if not negative
+    class Scope
+    {
+        const char* name;
+        int64_t arg;
+        int64_t start;
+
+    public:
+        Scope(const char* name, const int64_t& arg = -1) : name(name), arg(arg), start(IsEnabled() ? Now() : -1) {}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            if(start >= 0)
+                Record(name, arg, start, Now());
+        }
+    };
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Board.h"
 #include "Helpers.h"
 #include "Game.h"
+#include "Evaluator.h"
 
 using namespace std;
 
@@ -16,141 +17,12 @@ Board::Board()
 void Board::Reset()
 {
 	for_each(boardArr.begin(), boardArr.end(), [](auto& line) { line = 0;});
-    score = -INFINITY;
+    score = SCORE_INVALID;
 }
 
-int getRowTransitions(const Board& board)
+bool Board::IsPlayable(const score_t& score)
 {
-	int transitions = 0;
-	bool last_bit = 1;
-	bool bit;
-
-	for (int i = 0; i <= BLOCKS_H - 1; i++)
-	{
-		WidthInt row = board.boardArr[i];
-
-		for (int j = 0; j < BLOCKS_W; j++)
-		{
-			bit = (row >> (MAX_WIDTH - BLOCKS_W + j)) & (WidthInt)1;
-
-			if (bit != last_bit)
-				++transitions;
-
-			last_bit = bit;
-		}
-		if (bit == 0)
-			++transitions;
-		last_bit = 1;
-	}
-	return transitions;
-}
-
-int getColumnTransitions(const Board& board)
-{
-	int transitions = 0;
-	bool last_bit = 1;
-    int startingHeight = BLOCKS_H -1;
-
-	for (int i = 0; i < BLOCKS_W; ++i) {
-		for (int j = 0; j <= startingHeight; ++j) {
-			WidthInt row = board.boardArr[j];
-			bool bit = (row >> (MAX_WIDTH - BLOCKS_W + i)) & (WidthInt)1;
-
-			if (bit != last_bit) {
-				++transitions;
-			}
-
-			last_bit = bit;
-		}
-
-		last_bit = 1;
-	}
-
-	return transitions;
-}
-
-int getNumberOfHoles(const Board& board) {
-	int holes = 0;
-	WidthInt row_holes = 0;
-    int startingHeight = BLOCKS_H - 1;
-	WidthInt previous_row = board.boardArr[startingHeight];
-
-	for (int i = startingHeight - 1; i >= 0; --i) {
-		row_holes = ~board.boardArr[i] & (previous_row | row_holes);
-
-		for (int j = 0; j < BLOCKS_W; ++j) {
-			holes += ((row_holes >> (MAX_WIDTH - BLOCKS_W + j)) & (WidthInt)1);
-		}
-
-		previous_row = board.boardArr[i];
-	}
-
-	return holes;
-}
-
-
-int getWellSums(const Board& board) {
-	int well_sums = 0;
-
-	// Check for well cells in the "inner columns" of the board.
-	// "Inner columns" are the columns that aren't touching the edge of the board.
-    int startingHeight = BLOCKS_H - 1;
-
-	for (int i = 1; i < BLOCKS_W - 1; ++i) {
-		for (int j = startingHeight; j >= 0; --j) {
-			if (((board.boardArr[j] >> (MAX_WIDTH - BLOCKS_W + i - 1)) & (WidthInt)7) == (WidthInt)5) {
-
-				// Found well cell, count it + the number of empty cells below it.
-				++well_sums;
-				
-				for (int k = j - 1; k >= 0; --k) {
-					if (((board.boardArr[k] >> (MAX_WIDTH - BLOCKS_W + i)) & (WidthInt)1) == (WidthInt)0) {
-						++well_sums;
-					}
-					else {
-						break;
-					}
-				}
-			}
-		}
-	}
-
-	// Check for well cells in the leftmost column of the board.
-	for (int j = startingHeight; j >= 0; --j) {
-		if (((board.boardArr[j] >> (MAX_WIDTH - BLOCKS_W)) & (WidthInt)3) == (WidthInt)2) {
-
-			// Found well cell, count it + the number of empty cells below it.
-			++well_sums;
-
-			for (int k = j - 1; k >= 0; --k) {
-				if (((board.boardArr[k] >> (MAX_WIDTH - BLOCKS_W)) & (WidthInt)1) == (WidthInt)0) {
-					++well_sums;
-				}
-				else {
-					break;
-				}
-			}
-		}
-	}
-
-	// Check for well cells in the rightmost column of the board.
-	for (int j = startingHeight; j >= 0; --j) {
-		if (((board.boardArr[j] >> (MAX_WIDTH-2)) & (WidthInt)3) == (WidthInt)1) {
-			// Found well cell, count it + the number of empty cells below it.
-
-			++well_sums;
-			for (int k = j - 1; k >= 0; --k) {
-				if (((board.boardArr[k] >> (MAX_WIDTH - 1)) & (WidthInt)1) == (WidthInt)0) {
-					++well_sums;
-				}
-				else {
-					break;
-				}
-			}
-		}
-	}
-
-	return well_sums;
+    return score > SCORE_GAME_OVER;
 }
 
 void Board::SetScore(const int& destroyedLines, const int& dropHeight, const int& tetriminoRotationHeight)
@@ -158,15 +30,9 @@ void Board::SetScore(const int& destroyedLines, const int& dropHeight, const int
     score = CalculateScore(destroyedLines, dropHeight, tetriminoRotationHeight);
 }
 
-double Board::CalculateScore(const int& destroyedLines, const int& dropHeight, const int& tetriminoRotationHeight) const
+score_t Board::CalculateScore(const int& destroyedLines, const int& dropHeight, const int& tetriminoRotationHeight) const
 {
-    double adjustedDropHeight = dropHeight + ((tetriminoRotationHeight - 1)/2);
-    return (double)adjustedDropHeight * -4.500158825082766 +
-        (double)destroyedLines * 3.4181268101392694 +
-        (double)getRowTransitions(*this) * -3.2178882868487753 +
-        (double)getColumnTransitions(*this) * -9.348695305445199 +
-        (double)getNumberOfHoles(*this) * -7.899265427351652 +
-        (double)getWellSums(*this) * -3.3855972247263626;
+    return DefaultEvaluator::Score(*this, destroyedLines, dropHeight, tetriminoRotationHeight);
 }
 
 int Board::DropTetriminoRotation(const TetriminoRotation& tr)
@@ -206,6 +72,119 @@ int Board::DropTetriminoRotation(const TetriminoRotation& tr)
     }
 }
 
+void Board::PlaceTetriminoRotation(const TetriminoRotation& tr, const int& column, const int& height)
+{
+	for(int i = 0; i < tr.height; i++)
+	{
+		boardArr[height - i] |= tr.piece[i] >> column;
+	}
+}
+
+//rows of positions are bit sets of columns, laid out like the rows of the board
+//a position is blocked if any cell of the piece lands on a filled cell, every cell of a piece row
+//tests all the columns at once by shifting the whole board row under it
+void Board::ReachablePlacements(const TetriminoRotation& tr, board_t& resting) const
+{
+	const WidthInt validColumns = ~(~WidthInt(0) >> (BLOCKS_W - tr.width + 1));
+	board_t free;
+
+	resting.fill(0);
+	for(int height = tr.height - 1; height < BLOCKS_H; height++)
+	{
+		WidthInt blocked = 0;
+		for(int i = 0; i < tr.height; i++)
+		{
+			WidthInt row = boardArr[height - i];
+			for(WidthInt cells = tr.piece[i]; cells; cells &= cells - 1)
+			{
+				blocked |= row << (MAX_WIDTH - 1 - __builtin_ctz(cells));
+			}
+		}
+		free[height] = ~blocked & validColumns;
+	}
+
+	//sweep down from the top, sliding sideways through each row before falling to the next one
+	WidthInt reach = free[BLOCKS_H - 1];
+	for(int height = BLOCKS_H - 1; height >= tr.height - 1; height--)
+	{
+		for(WidthInt last = 0; last != reach;)
+		{
+			last = reach;
+			reach = (reach | (reach << 1) | (reach >> 1)) & free[height];
+		}
+
+		if(height == tr.height - 1)
+		{
+			resting[height] = reach;
+		}
+		else
+		{
+			resting[height] = reach & ~free[height - 1];
+			reach &= free[height - 1];
+		}
+	}
+}
+
+void Board::Placements(const Tetrimino& tetrimino, PlacementBatch& batch) const
+{
+	board_t resting;
+	batch.size = 0;
+	for(const TetriminoRotation& tr : tetrimino.tetriminoRotations)
+	{
+		ReachablePlacements(tr, resting);
+
+		size_t count = 0;
+		for(int height = tr.height - 1; height < BLOCKS_H; height++)
+		{
+			count += __builtin_popcount(resting[height]);
+		}
+		batch.Reserve(batch.size + count);
+
+		size_t i = batch.size;
+		for(int height = tr.height - 1; height < BLOCKS_H; height++)
+		{
+			for(WidthInt columns = resting[height]; columns; columns &= columns - 1)
+			{
+				Board& child = batch.boards[i];
+				child = *this;
+				child.PlaceTetriminoRotation(tr, MAX_WIDTH - 1 - __builtin_ctz(columns), height);
+				batch.destroyedLines[i] = child.CompactLines(height, tr.height);
+				batch.dropHeights[i] = height;
+				batch.trHeights[i] = tr.height;
+				i++;
+			}
+		}
+		batch.size = i;
+	}
+}
+
+//only the rows under the piece can be full, every row above the lowest of them moves down by the number of full rows
+//under it, which is counted as the rows are copied instead of branching on each one
+int Board::CompactLines(const int& dropHeight, const int& trHeight)
+{
+	int low = dropHeight - trHeight + 1;
+	int cleared = 0;
+	for(int i = low; i <= dropHeight; i++)
+	{
+		cleared += boardArr[i] == FULL_LINE;
+	}
+	if(!cleared)
+		return 0;
+
+	int destination = low;
+	for(int i = low; i < BLOCKS_H; i++)
+	{
+		WidthInt row = boardArr[i];
+		boardArr[destination] = row;
+		destination += row != FULL_LINE;
+	}
+	for(int i = BLOCKS_H - cleared; i < BLOCKS_H; i++)
+	{
+		boardArr[i] = 0;
+	}
+	return cleared;
+}
+
 //returns 1 if destroyed line, 0 if no line destroyed
 int destroySingleLine(board_t& board, const int& height)
 {
@@ -236,9 +215,9 @@ int Board::DestroyLines(const int& dropHeight, const int& tetriminoRotationHeigh
 	return d;
 }
 
-double Board::BestSubScore(const int& currentDepth, const int& maxDepth, const deque<int>& tetriminoQueue) const
+score_t Board::BestSubScore(const int& currentDepth, const int& maxDepth, const deque<int>& tetriminoQueue) const
 {
-	double best = -INFINITY;
+	score_t best = SCORE_GAME_OVER;
     const Tetrimino& tetrimino = Game::tetriminos[tetriminoQueue[currentDepth]];
 
     Helpers::ForEachTrPos(tetrimino, [this, &best, currentDepth, maxDepth, tetriminoQueue](const TetriminoRotation& tr){
@@ -254,7 +233,7 @@ double Board::BestSubScore(const int& currentDepth, const int& maxDepth, const d
 
 void Board::ResursiveScoreCalculator(const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr, Board& best, const deque<int>& tetriminoQueue) const
 {
-    double score;
+    score_t score;
     if(LOOK_AHEAD == 1)
         score = CalculateScore(destroyedLines, dropHeight, tr.height);
     else
@@ -267,9 +246,9 @@ void Board::ResursiveScoreCalculator(const int& destroyedLines, const int& dropH
     }
 }
 
-void Board::SubScoreCalculator(const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr, double& best, const int& currentDepth, const int& maxDepth, const std::deque<int>& tetriminoQueue) const
+void Board::SubScoreCalculator(const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr, score_t& best, const int& currentDepth, const int& maxDepth, const std::deque<int>& tetriminoQueue) const
 {
-    double score;
+    score_t score;
 
     if(currentDepth == maxDepth)
         score = CalculateScore(destroyedLines, dropHeight, tr.height);
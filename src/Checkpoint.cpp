@@ -0,0 +1,276 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <type_traits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Checkpoint.h"
+#include "Game.h"
+
+using namespace std;
+
+namespace
+{
+	const char magic[8] = {'T', 'B', 'S', 'A', 'V', 'E', '3', '\0'};
+
+	class Writer
+	{
+	public:
+		string bytes;
+
+		template <typename T>
+		void Put(const T& value)
+		{
+			static_assert(is_trivially_copyable<T>::value, "only plain values are written as bytes");
+			bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+
+		void Put(const string& s)
+		{
+			Put<uint64_t>(s.size());
+			bytes.append(s);
+		}
+
+		void Put(const deque<int>& queue)
+		{
+			Put<uint64_t>(queue.size());
+			for(const int& piece : queue)
+			{
+				Put<int32_t>(piece);
+			}
+		}
+
+		void Put(const Board& board)
+		{
+			Put(board.boardArr);
+			Put(board.score);
+		}
+
+		void Put(const SearchNode& node)
+		{
+			Put(node.board);
+			Put<int32_t>(node.destroyedLines);
+			Put<int32_t>(node.dropHeight);
+			Put<int32_t>(node.trHeight);
+			Put<int32_t>(node.hold);
+			Put<int32_t>(node.consumed);
+			Put<uint8_t>(node.expanded);
+			Put<uint8_t>(node.holdExpanded);
+			Put<uint64_t>(node.children.size());
+			for(const SearchNode& child : node.children)
+			{
+				Put(child);
+			}
+		}
+	};
+
+	class Reader
+	{
+		const char* data;
+		size_t size;
+		size_t offset = 0;
+		const string& fileName;
+
+		void Need(const size_t& n)
+		{
+			if(n > size - offset)
+				Game::Fatal("Truncated checkpoint: " + fileName);
+		}
+
+	public:
+		Reader(const char* data, const size_t& size, const string& fileName) : data(data), size(size), fileName(fileName) {}
+
+		template <typename T>
+		void Get(T& value)
+		{
+			static_assert(is_trivially_copyable<T>::value, "only plain values are read as bytes");
+			Need(sizeof(value));
+			memcpy(&value, data + offset, sizeof(value));
+			offset += sizeof(value);
+		}
+
+		template <typename T>
+		T Get()
+		{
+			T value;
+			Get(value);
+			return value;
+		}
+
+		void Get(string& s)
+		{
+			uint64_t length = Get<uint64_t>();
+			Need(length);
+			s.assign(data + offset, length);
+			offset += length;
+		}
+
+		void Get(deque<int>& queue)
+		{
+			uint64_t length = Get<uint64_t>();
+			Need(length * sizeof(int32_t));
+			queue.clear();
+			for(uint64_t i = 0; i < length; i++)
+			{
+				queue.push_back(Piece(Get<int32_t>()));
+			}
+		}
+
+		void Get(Board& board)
+		{
+			Get(board.boardArr);
+			Get(board.score);
+		}
+
+		void Get(SearchNode& node)
+		{
+			Get(node.board);
+			node.destroyedLines = Get<int32_t>();
+			node.dropHeight = Get<int32_t>();
+			node.trHeight = Get<int32_t>();
+			node.hold = Hold(Get<int32_t>());
+			node.consumed = Get<int32_t>();
+			node.expanded = Get<uint8_t>();
+			node.holdExpanded = Get<uint8_t>();
+
+			//every child takes more than a byte, a damaged count can't make it allocate more than the file
+			uint64_t numChildren = Get<uint64_t>();
+			Need(numChildren);
+			node.children.resize(numChildren);
+			for(SearchNode& child : node.children)
+			{
+				Get(child);
+			}
+		}
+
+		int Piece(const int& piece)
+		{
+			if(piece < 0 || piece >= NUM_PIECES)
+				Game::Fatal("Bad piece in checkpoint: " + fileName);
+			return piece;
+		}
+
+		int Hold(const int& hold)
+		{
+			return hold < 0 ? -1 : Piece(hold);
+		}
+
+		bool AtEnd() const
+		{
+			return offset == size;
+		}
+	};
+
+	void WriteAll(const int& fd, const char* data, size_t size, const string& fileName)
+	{
+		while(size > 0)
+		{
+			ssize_t written = write(fd, data, size);
+			if(written <= 0)
+				Game::Fatal("Failed writing checkpoint: " + fileName);
+			data += written;
+			size -= written;
+		}
+	}
+}
+
+void Checkpoint::Write(const string& fileName, const string& evaluator, const GameState& state)
+{
+	Writer writer;
+	writer.Put(state.board);
+	writer.Put<int32_t>(state.hold);
+	writer.Put(state.tetriminoQueue);
+	writer.Put<int32_t>(state.upcomingPiece);
+	writer.Put(state.rng);
+	writer.Put(state.searchRng);
+	writer.Put(state.deaths);
+	writer.Put(state.totalBlocks);
+	writer.Put(state.avgBlocksPerGame);
+	writer.Put(state.totalScore);
+	writer.Put(state.bookHits);
+	writer.Put(state.rolloutStats);
+	writer.Put(state.treeRoot);
+	writer.Put(state.treeQueue);
+
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.blocksW = BLOCKS_W;
+	header.blocksH = BLOCKS_H;
+	header.lookAhead = LOOK_AHEAD;
+	header.numPieces = NUM_PIECES;
+	strncpy(header.evaluator, evaluator.c_str(), sizeof(header.evaluator) - 1);
+	header.size = writer.bytes.size();
+
+	string tmpName = fileName + ".tmp";
+	int fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		Game::Fatal("Cannot write checkpoint: " + tmpName);
+
+	WriteAll(fd, reinterpret_cast<const char*>(&header), sizeof(header), tmpName);
+	WriteAll(fd, writer.bytes.data(), writer.bytes.size(), tmpName);
+	if(fsync(fd) != 0 || close(fd) != 0)
+		Game::Fatal("Failed writing checkpoint: " + tmpName);
+
+	if(rename(tmpName.c_str(), fileName.c_str()) != 0)
+		Game::Fatal("Cannot rename checkpoint to " + fileName);
+}
+
+GameState Checkpoint::Read(const string& fileName, const string& evaluator)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if(fd < 0)
+		Game::Fatal("Cannot open checkpoint: " + fileName);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CheckpointHeader))
+		Game::Fatal("Checkpoint too small: " + fileName);
+
+	string bytes(st.st_size, '\0');
+	size_t done = 0;
+	while(done < bytes.size())
+	{
+		ssize_t got = read(fd, &bytes[done], bytes.size() - done);
+		if(got <= 0)
+			Game::Fatal("Failed reading checkpoint: " + fileName);
+		done += got;
+	}
+	close(fd);
+
+	CheckpointHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	if(memcmp(header.magic, magic, sizeof(magic)) != 0)
+		Game::Fatal("Not a checkpoint: " + fileName);
+
+	if(header.blocksW != BLOCKS_W || header.blocksH != BLOCKS_H || header.lookAhead != LOOK_AHEAD || header.numPieces != NUM_PIECES)
+		Game::Fatal("Checkpoint written with other constants: " + fileName);
+
+	if(string(header.evaluator, strnlen(header.evaluator, sizeof(header.evaluator))) != evaluator)
+		Game::Fatal("Checkpoint written for evaluator " + string(header.evaluator) + ": " + fileName);
+
+	if(header.size != bytes.size() - sizeof(header))
+		Game::Fatal("Truncated checkpoint: " + fileName);
+
+	GameState state;
+	Reader reader(bytes.data() + sizeof(header), header.size, fileName);
+	reader.Get(state.board);
+	state.hold = reader.Hold(reader.Get<int32_t>());
+	reader.Get(state.tetriminoQueue);
+	state.upcomingPiece = reader.Hold(reader.Get<int32_t>());
+	reader.Get(state.rng);
+	reader.Get(state.searchRng);
+	reader.Get(state.deaths);
+	reader.Get(state.totalBlocks);
+	reader.Get(state.avgBlocksPerGame);
+	reader.Get(state.totalScore);
+	reader.Get(state.bookHits);
+	reader.Get(state.rolloutStats);
+	reader.Get(state.treeRoot);
+	reader.Get(state.treeQueue);
+
+	if(!reader.AtEnd() || state.tetriminoQueue.size() != LOOK_AHEAD)
+		Game::Fatal("Damaged checkpoint: " + fileName);
+
+	return state;
+}
\ No newline at end of file
@@ -0,0 +1,499 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Farm.h"
+#include "Trace.h"
+
+using namespace std;
+
+namespace
+{
+	void SendAll(const int& fd, const string& data)
+	{
+		size_t sent = 0;
+		while(sent < data.size())
+		{
+			ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if(n < 0 && errno == EINTR)
+				continue;
+			if(n <= 0)
+				Game::Fatal("Lost the farm coordinator");
+			sent += n;
+		}
+	}
+
+	//false once the coordinator closed the connection
+	bool ReadLine(const int& fd, string& buffer, string& line)
+	{
+		size_t newline;
+		while((newline = buffer.find('\n')) == string::npos)
+		{
+			char chunk[4096];
+			ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+			if(n < 0 && errno == EINTR)
+				continue;
+			if(n <= 0)
+				return false;
+			buffer.append(chunk, n);
+		}
+
+		line = buffer.substr(0, newline);
+		buffer.erase(0, newline + 1);
+		return true;
+	}
+
+	double SecondsSince(const chrono::steady_clock::time_point& start)
+	{
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+FarmCoordinator::FarmCoordinator(const FarmConfig& config, const uint16_t& port, const string& traceFile) : config(config), traceFile(traceFile)
+{
+	respawns = 0;
+	batchesDone = 0;
+	batchSeconds = 0;
+
+	listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	if(listenFd < 0)
+		Game::Fatal("Cannot create the farm socket");
+
+	int reuse = 1;
+	setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if(bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 64) != 0)
+		Game::Fatal("Cannot listen on farm port " + to_string(port));
+
+	socklen_t length = sizeof(address);
+	getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+	this->port = ntohs(address.sin_port);
+	Game::Log("Farm listening on 127.0.0.1:" + to_string(this->port));
+}
+
+FarmCoordinator::~FarmCoordinator()
+{
+	for(auto& connection : connections)
+	{
+		Send(connection, "QUIT");
+		close(connection.fd);
+	}
+
+	//workers still playing a batch somebody else finished first are not waited for
+	for(pid_t child : children)
+	{
+		kill(child, SIGKILL);
+		waitpid(child, nullptr, 0);
+	}
+	close(listenFd);
+}
+
+vector<FarmResult> FarmCoordinator::Run(const uint64_t& firstSeed, const uint64_t& numGames, const uint& numWorkers)
+{
+	for(uint64_t seed = firstSeed; seed < firstSeed + numGames; seed += FARM_BATCH_SEEDS)
+	{
+		Batch batch;
+		batch.firstSeed = seed;
+		batch.numSeeds = min<uint64_t>(FARM_BATCH_SEEDS, firstSeed + numGames - seed);
+		pending.push_back(batches.size());
+		batches.push_back(batch);
+	}
+
+	for(uint i = 0; i < numWorkers; i++)
+	{
+		Spawn();
+	}
+
+	bool waiting = false;
+	while(batchesDone < batches.size())
+	{
+		Reap();
+		//workers that crashed are replaced, as many times as there were workers to begin with
+		while(children.size() < numWorkers && respawns < numWorkers)
+		{
+			Spawn();
+			respawns++;
+		}
+
+		//a farm without spawned workers relies on the ones started by hand, one that spawned them gives up once they are all gone
+		if(children.empty() && connections.empty())
+		{
+			if(numWorkers > 0)
+				Game::Fatal("Every farm worker died, " + to_string(batches.size() - batchesDone) + " of " + to_string(batches.size()) + " batches not played");
+			if(!waiting)
+				Game::Log("Waiting for farm workers on 127.0.0.1:" + to_string(port));
+			waiting = true;
+		}
+		else
+		{
+			waiting = false;
+		}
+
+		for(auto& connection : connections)
+		{
+			if(connection.pid > 0 && connection.batch < 0)
+				Assign(connection);
+		}
+
+		vector<pollfd> fds(1 + connections.size());
+		fds[0] = pollfd{listenFd, POLLIN, 0};
+		for(size_t i = 0; i < connections.size(); i++)
+		{
+			fds[i + 1] = pollfd{connections[i].fd, POLLIN, 0};
+		}
+
+		if(poll(fds.data(), fds.size(), 1000) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			Game::Fatal("Farm poll failed");
+		}
+
+		for(size_t i = 0; i < connections.size(); i++)
+		{
+			if(fds[i + 1].revents && !Receive(connections[i]))
+				Drop(connections[i]);
+		}
+		connections.erase(remove_if(connections.begin(), connections.end(), [](const Connection& c){return c.fd < 0;}), connections.end());
+
+		if(fds[0].revents & POLLIN)
+			Accept();
+	}
+
+	sort(results.begin(), results.end(), [](const FarmResult& a, const FarmResult& b){return a.seed < b.seed;});
+	return results;
+}
+
+void FarmCoordinator::Spawn()
+{
+	pid_t pid = fork();
+	if(pid < 0)
+		Game::Fatal("Cannot spawn a farm worker");
+
+	if(pid == 0)
+	{
+		//the games print their progress, only the coordinator reports
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		close(listenFd);
+
+		string address = "127.0.0.1:" + to_string(port);
+		execl("/proc/self/exe", "tetris_bot", "--farm-worker", address.c_str(), (char*)nullptr);
+		_exit(127);
+	}
+
+	children.push_back(pid);
+}
+
+void FarmCoordinator::Reap()
+{
+	int status;
+	pid_t pid;
+	while((pid = waitpid(-1, &status, WNOHANG)) > 0)
+	{
+		children.erase(remove(children.begin(), children.end(), pid), children.end());
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			Game::Log("Farm worker " + to_string(pid) + " died");
+	}
+}
+
+void FarmCoordinator::Accept()
+{
+	int fd = accept(listenFd, nullptr, nullptr);
+	if(fd < 0)
+		return;
+
+	Connection connection;
+	connection.fd = fd;
+	connections.push_back(move(connection));
+}
+
+bool FarmCoordinator::Receive(Connection& connection)
+{
+	char chunk[65536];
+	ssize_t n = recv(connection.fd, chunk, sizeof(chunk), 0);
+	if(n < 0 && (errno == EINTR || errno == EAGAIN))
+		return true;
+	if(n <= 0)
+		return false;
+	connection.input.append(chunk, n);
+
+	size_t newline;
+	while((newline = connection.input.find('\n')) != string::npos)
+	{
+		string line = connection.input.substr(0, newline);
+
+		//the trace follows its line as raw bytes
+		if(line.compare(0, 6, "TRACE ") == 0)
+		{
+			istringstream in(line.substr(6));
+			int batch;
+			size_t size;
+			if(!(in >> batch >> size))
+				return false;
+			if(connection.input.size() < newline + 1 + size)
+				break;
+			if(batch == connection.batch)
+				connection.trace = connection.input.substr(newline + 1, size);
+			connection.input.erase(0, newline + 1 + size);
+			continue;
+		}
+
+		connection.input.erase(0, newline + 1);
+		if(!Handle(connection, line))
+			return false;
+	}
+	return true;
+}
+
+bool FarmCoordinator::Handle(Connection& connection, const string& line)
+{
+	istringstream in(line);
+	string command;
+	in >> command;
+
+	if(command == "HELLO")
+	{
+		if(!(in >> connection.pid) || connection.pid <= 0)
+			return false;
+
+		const GameOptions& options = config.options;
+		Send(connection, "CONFIG " + to_string(config.moves) + " " + to_string(options.pipelined) + " " + to_string(options.rollouts) + " "
+			+ to_string(config.trace) + " " + options.evaluator + " " + (options.book.empty() ? "-" : options.book));
+		return true;
+	}
+
+	int batch;
+	if(!(in >> batch))
+		return false;
+	//messages about a batch the worker wasn't given are ignored
+	if(batch != connection.batch)
+		return true;
+
+	if(command == "RESULT")
+	{
+		FarmResult result;
+		GameStatistics& statistics = result.statistics;
+		if(!(in >> result.seed >> statistics.deaths >> statistics.totalBlocks >> statistics.bookHits >> statistics.totalScore))
+			return false;
+		connection.results.push_back(result);
+		return true;
+	}
+
+	if(command == "DONE")
+	{
+		if(connection.results.size() != batches[batch].numSeeds)
+			return false;
+		Finish(connection);
+		return true;
+	}
+
+	Game::Log("Bad message from farm worker " + to_string(connection.pid) + ": " + line);
+	return false;
+}
+
+//the batch of a worker that disconnected goes back to the front of the queue unless another worker still plays it
+void FarmCoordinator::Drop(Connection& connection)
+{
+	close(connection.fd);
+	connection.fd = -1;
+
+	if(connection.batch < 0)
+		return;
+
+	Batch& batch = batches[connection.batch];
+	batch.running--;
+	if(!batch.done && batch.running == 0)
+	{
+		pending.push_front(connection.batch);
+		Game::Log("Lost farm worker " + to_string(connection.pid) + ", seeds from " + to_string(batch.firstSeed) + " requeued");
+	}
+}
+
+//idle workers take the next pending batch, once there are none they duplicate a batch running FARM_SLOW_FACTOR times
+//longer than the average, whichever copy finishes first counts
+void FarmCoordinator::Assign(Connection& connection)
+{
+	int next = -1;
+	if(!pending.empty())
+	{
+		next = pending.front();
+		pending.pop_front();
+	}
+	else if(batchesDone > 0)
+	{
+		double slow = FARM_SLOW_FACTOR * batchSeconds / batchesDone;
+		for(const auto& other : connections)
+		{
+			if(other.batch >= 0 && batches[other.batch].running == 1 && SecondsSince(other.started) > slow)
+			{
+				next = other.batch;
+				Game::Log("Seeds from " + to_string(batches[next].firstSeed) + " are slow on farm worker " + to_string(other.pid)
+					+ ", also giving them to " + to_string(connection.pid));
+				break;
+			}
+		}
+	}
+
+	if(next < 0)
+		return;
+
+	Batch& batch = batches[next];
+	batch.running++;
+	connection.batch = next;
+	connection.started = chrono::steady_clock::now();
+	connection.results.clear();
+	connection.trace.clear();
+	Send(connection, "BATCH " + to_string(next) + " " + to_string(batch.firstSeed) + " " + to_string(batch.numSeeds));
+}
+
+void FarmCoordinator::Finish(Connection& connection)
+{
+	Batch& batch = batches[connection.batch];
+	batch.running--;
+	connection.batch = -1;
+	if(batch.done)
+		return;
+
+	batch.done = true;
+	batchesDone++;
+	double seconds = SecondsSince(connection.started);
+	batchSeconds += seconds;
+	results.insert(results.end(), connection.results.begin(), connection.results.end());
+
+	if(!traceFile.empty() && !connection.trace.empty())
+	{
+		string fileName = traceFile + "." + to_string(batch.firstSeed);
+		ofstream file(fileName, ios::trunc);
+		file << connection.trace;
+		if(!file)
+			Game::Fatal("Cannot write trace: " + fileName);
+	}
+
+	ostringstream report;
+	report << "Seeds " << batch.firstSeed << "-" << batch.firstSeed + batch.numSeeds - 1 << " played by farm worker " << connection.pid
+		<< " in " << fixed << setprecision(1) << seconds << "s (" << batchesDone << "/" << batches.size() << ")";
+	Game::Log(report.str());
+}
+
+void FarmCoordinator::Send(Connection& connection, const string& line)
+{
+	//a worker that can't be written to shows up as disconnected on the next poll
+	string data = line + "\n";
+	send(connection.fd, data.data(), data.size(), MSG_NOSIGNAL);
+}
+
+void RunFarmWorker(const string& address)
+{
+	size_t colon = address.rfind(':');
+	if(colon == string::npos)
+		Game::Fatal("Farm address must be host:port: " + address);
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* found;
+	if(getaddrinfo(address.substr(0, colon).c_str(), address.substr(colon + 1).c_str(), &hints, &found) != 0)
+		Game::Fatal("Cannot resolve farm coordinator " + address);
+
+	int fd = -1;
+	for(addrinfo* candidate = found; candidate && fd < 0; candidate = candidate->ai_next)
+	{
+		fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+		if(fd >= 0 && connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(found);
+	if(fd < 0)
+		Game::Fatal("Cannot connect to farm coordinator " + address);
+
+	SendAll(fd, "HELLO " + to_string(getpid()) + "\n");
+
+	FarmConfig config;
+	string buffer;
+	string line;
+	while(ReadLine(fd, buffer, line))
+	{
+		istringstream in(line);
+		string command;
+		in >> command;
+
+		if(command == "CONFIG")
+		{
+			GameOptions& options = config.options;
+			if(!(in >> config.moves >> options.pipelined >> options.rollouts >> config.trace >> options.evaluator >> options.book))
+				Game::Fatal("Bad farm config: " + line);
+			if(options.book == "-")
+				options.book.clear();
+			if(config.trace)
+			{
+				Trace::Enable();
+				Trace::SetThreadName("farm worker");
+			}
+		}
+		else if(command == "BATCH")
+		{
+			int batch;
+			uint64_t firstSeed;
+			uint64_t numSeeds;
+			if(!(in >> batch >> firstSeed >> numSeeds))
+				Game::Fatal("Bad farm batch: " + line);
+
+			for(uint64_t seed = firstSeed; seed < firstSeed + numSeeds; seed++)
+			{
+				GameOptions options = config.options;
+				options.seed = seed;
+				Game game(options);
+				for(uint64_t i = 0; i < config.moves; i++)
+				{
+					game.Update();
+				}
+
+				GameStatistics statistics = game.Statistics();
+				ostringstream result;
+				result << setprecision(17) << "RESULT " << batch << " " << seed << " " << statistics.deaths << " " << statistics.totalBlocks
+					<< " " << statistics.bookHits << " " << statistics.totalScore << "\n";
+				SendAll(fd, result.str());
+			}
+
+			if(config.trace)
+			{
+				ostringstream trace;
+				Trace::Write(trace);
+				Trace::Clear();
+				SendAll(fd, "TRACE " + to_string(batch) + " " + to_string(trace.str().size()) + "\n" + trace.str());
+			}
+			SendAll(fd, "DONE " + to_string(batch) + "\n");
+		}
+		else if(command == "QUIT")
+		{
+			break;
+		}
+		else
+		{
+			Game::Fatal("Bad message from farm coordinator: " + line);
+		}
+	}
+
+	close(fd);
+}
\ No newline at end of file
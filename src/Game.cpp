@@ -5,59 +5,112 @@
 #include <queue>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <future>
 
 #include "Helpers.h"
 #include "Game.h"
 #include "utility"
 #include "Board.h"
+#include "Trace.h"
 
 using namespace std;
 
 void Game::Update()
 {
-	UpdateQueue();
+	Trace::Scope moveScope("Move", totalBlocks);
 
-	auto&& bestboard = (*findBestBoard_Rec_Channels)(board, tetriminoQueue);
-	//auto&& bestboard = FindBestBoard_SingleThread();
+	{
+		Trace::Scope scope("UpdateQueue");
+		UpdateQueue();
+	}
+
+	SearchResult bestboard;
+	{
+		Trace::Scope scope("Search");
+		if(book.Find(board, hold, tetriminoQueue, bestboard))
+		{
+			bookHits++;
+			//the speculation queued for this move would only keep the workers busy until the next Take drops it
+			speculativeSearch.Cancel();
+		}
+		else if(options.rollouts)
+			bestboard = (*rolloutSearch)(board, hold, tetriminoQueue);
+		else if(!options.pipelined)
+			bestboard = (*findBestBoard_Rec_Channels)(board, hold, tetriminoQueue);
+		else
+		{
+			if(!TakeSpeculation(bestboard))
+				bestboard = (*findBestBoard_Rec_Channels)(board, hold, tetriminoQueue, [this](const vector<SearchNode>& candidates){
+					Speculate(candidates);
+				});
+			//only the speculation started from the chosen placement can be taken by the next move
+			speculativeSearch.Keep(bestboard.board, bestboard.hold);
+		}
+		//auto&& bestboard = FindBestBoard_SingleThread();
+	}
 
-	UpdateBoard(move(bestboard));
-	totalBlocks++;
+	{
+		Trace::Scope scope("ApplyBoard");
+		UpdateBoard(move(bestboard));
+		totalBlocks++;
+		CheckGameOver(board.score);
+	}
 
-	CheckGameOver(board.score);
-	PrintFPS();
+	{
+		Trace::Scope scope("Print");
+		PrintFPS();
+	}
+
+	if(options.checkpointEvery && totalBlocks % options.checkpointEvery == 0)
+	{
+		Trace::Scope scope("Checkpoint");
+		SaveCheckpoint();
+	}
 
 	//PrintBoard();
 	//cout << "Press Enter to Continue";
 	//cin.ignore();
 }
 
-void Game::CheckGameOver(const double& score)
+void Game::CheckGameOver(const score_t& score)
 {
-	if(score == -INFINITY)
+	if(!Board::IsPlayable(score))
 	{
 		board.Reset();
+		hold = -1;
 		deaths++;
 		avgBlocksPerGame = totalBlocks / double(deaths);
 	}
 	else
 	{
-		totalScore += score;
+		totalScore += score / double(SCORE_SCALE);
 	}
 }
 
-Game::Game()
+Game::Game(const GameOptions& options) : options(options)
 {
     if(MAX_WIDTH < BLOCKS_W)
     {
         Fatal("MAX_WIDTH < BLOCKS_W");
     }
 
-	//init channel ptr
-	findBestBoard_Rec_Channels = make_unique<FindBestBoard_Rec_Channels>(NUM_WORKERS);
+	//init channel ptr, rollout mode has its own workers
+	if(!options.rollouts)
+	{
+		findBestBoard_Rec_Channels = make_unique<FindBestBoard_Rec_Channels>(NUM_WORKERS);
+		findBestBoard_Rec_Channels->SetEvaluator(options.evaluator);
+	}
+
+	if(!options.book.empty())
+		book.Open(options.book, options.evaluator);
 
     //init queue
     random_device device;
-    rng = make_unique<mt19937>(device());
+    rng = make_unique<mt19937>(options.seed ? options.seed : device());
+
+	if(options.rollouts)
+		rolloutSearch = make_unique<RolloutSearch>(NUM_WORKERS, options.seed ? options.seed : device());
     dist = make_unique<std::uniform_int_distribution<std::mt19937::result_type>>(0,tetriminos.size() - 1);
 
     for(int i = 0; i < LOOK_AHEAD; i++)
@@ -65,20 +118,150 @@ Game::Game()
         tetriminoQueue.push_back((*dist)(*rng));
     }
 
+	upcomingPiece = -1;
+	hold = -1;
 	deaths = 0;
 	totalBlocks = 0;
+	totalScore = 0;
+	bookHits = 0;
 	avgBlocksPerGame = 0;
+
+	if(!options.resume.empty())
+		Restore(Checkpoint::Read(options.resume, options.evaluator));
 }
 
-void Game::UpdateBoard(Board&& board)
+void Game::UpdateBoard(SearchResult&& result)
 {
-    this->board = move(board);
+    this->board = move(result.board);
+    hold = result.hold;
+
+    //the piece that went into the empty hold slot leaves the queue too
+    if(result.consumed == 2)
+        UpdateQueue();
 }
 
 void Game::UpdateQueue()
 {
-    tetriminoQueue.push_back((*dist)(*rng));
-    tetriminoQueue.pop_front();
+    tetriminoQueue = NextQueue();
+    upcomingPiece = -1;
+}
+
+//queue of the next move, the new piece is drawn once and kept until UpdateQueue
+deque<int> Game::NextQueue()
+{
+    if(upcomingPiece < 0)
+        upcomingPiece = (*dist)(*rng);
+
+    deque<int> next(tetriminoQueue);
+    next.push_back(upcomingPiece);
+    next.pop_front();
+    return next;
+}
+
+//the move being searched never looks at the drawn piece, only the speculative searches of the move after it do
+void Game::Speculate(const vector<SearchNode>& candidates)
+{
+	speculativeSearch.Launch(candidates, tetriminoQueue, NextQueue(), options.evaluator, *findBestBoard_Rec_Channels);
+}
+
+bool Game::TakeSpeculation(SearchResult& best)
+{
+	Trace::Scope scope("TakeSpeculation");
+	SpeculationResult result;
+	//the move after this one is speculated while the end of this one is still being searched
+	if(!speculativeSearch.Take(board, hold, tetriminoQueue, result, [this](const vector<SearchNode>& candidates){Speculate(candidates);}))
+		return false;
+
+	best = result.best;
+	findBestBoard_Rec_Channels->Adopt(move(result.tree));
+
+	return true;
+}
+
+//copied between moves, the search workers are idle then and only the copy is written in the background
+GameState Game::Snapshot() const
+{
+	GameState state;
+	state.board = board;
+	state.hold = hold;
+	state.tetriminoQueue = tetriminoQueue;
+	state.upcomingPiece = upcomingPiece;
+
+	ostringstream rngState;
+	rngState << *rng;
+	state.rng = rngState.str();
+	if(rolloutSearch)
+	{
+		state.searchRng = rolloutSearch->RngState();
+		state.rolloutStats = rolloutSearch->Chosen();
+	}
+
+	state.deaths = deaths;
+	state.totalBlocks = totalBlocks;
+	state.avgBlocksPerGame = avgBlocksPerGame;
+	state.totalScore = totalScore;
+	state.bookHits = bookHits;
+
+	if(findBestBoard_Rec_Channels)
+	{
+		const SearchTree& tree = findBestBoard_Rec_Channels->Tree();
+		state.treeRoot = tree.Root();
+		state.treeQueue = tree.ExpandedQueue();
+	}
+	return state;
+}
+
+void Game::Restore(GameState&& state)
+{
+	board = state.board;
+	hold = state.hold;
+	tetriminoQueue = state.tetriminoQueue;
+	upcomingPiece = state.upcomingPiece;
+
+	istringstream rngState(state.rng);
+	if(!(rngState >> *rng))
+		Fatal("Bad generator state in checkpoint: " + options.resume);
+	if(rolloutSearch && !state.searchRng.empty())
+	{
+		rolloutSearch->SetRngState(state.searchRng);
+		rolloutSearch->SetChosen(state.rolloutStats);
+	}
+
+	deaths = state.deaths;
+	totalBlocks = state.totalBlocks;
+	avgBlocksPerGame = state.avgBlocksPerGame;
+	totalScore = state.totalScore;
+	bookHits = state.bookHits;
+
+	if(findBestBoard_Rec_Channels)
+	{
+		SearchTree tree;
+		tree.SetEvaluator(options.evaluator);
+		tree.Adopt(move(state.treeRoot), state.treeQueue);
+		findBestBoard_Rec_Channels->Adopt(move(tree));
+	}
+}
+
+void Game::SaveCheckpoint(const bool& wait)
+{
+	if(options.checkpoint.empty())
+		return;
+
+	if(pendingCheckpoint.valid())
+	{
+		if(!wait && pendingCheckpoint.wait_for(chrono::seconds(0)) != future_status::ready)
+			return;
+		pendingCheckpoint.get();
+	}
+
+	pendingCheckpoint = async(launch::async, [fileName = options.checkpoint, evaluator = options.evaluator, state = Snapshot()](){
+		Trace::SetThreadName("checkpoint");
+		Trace::Scope scope("WriteCheckpoint");
+		Checkpoint::Write(fileName, evaluator, state);
+	});
+
+	if(wait)
+		pendingCheckpoint.get();
 }
 
 void Game::PrintFPS() const
@@ -103,7 +286,25 @@ void Game::PrintFPS() const
 
 void Game::PrintStatistics() const
 {
-	cout << "Avg Blocks Per Game: " << avgBlocksPerGame << "  Deaths: " << deaths << "  Avg Score: " << totalScore / totalBlocks << endl;
+	cout << "Avg Blocks Per Game: " << avgBlocksPerGame << "  Deaths: " << deaths << "  Avg Score: " << totalScore / totalBlocks;
+	if(book.IsOpen())
+		cout << "  Book Hits: " << 100.0 * bookHits / totalBlocks << "%";
+	if(rolloutSearch && rolloutSearch->Chosen().playouts)
+	{
+		const RolloutStats& chosen = rolloutSearch->Chosen();
+		cout << "  Rollout Survival: " << 100.0 * chosen.survived / chosen.playouts << "%  Lines Per Rollout: " << chosen.lines / double(chosen.playouts);
+	}
+	cout << endl;
+}
+
+GameStatistics Game::Statistics() const
+{
+	GameStatistics statistics;
+	statistics.deaths = deaths;
+	statistics.totalBlocks = totalBlocks;
+	statistics.bookHits = bookHits;
+	statistics.totalScore = totalScore;
+	return statistics;
 }
 
 Board Game::FindBestBoard_SingleThread() const
@@ -126,7 +327,7 @@ Board Game::FindBestBoard_MultiThread() const
 	vector<future<Board>> futures;
 
 	auto cmp = [](auto a, auto b){return a.first < b.first;};
-	priority_queue<pair<double, Board>, vector<pair<double, Board>>, decltype(cmp)> scoresAndBoards(cmp);
+	priority_queue<pair<score_t, Board>, vector<pair<score_t, Board>>, decltype(cmp)> scoresAndBoards(cmp);
 	const Tetrimino& tetrimino = tetriminos[tetriminoQueue[0]];
 
 	Helpers::ForEachTrPos(tetrimino, [this, &futures](TetriminoRotation& tr){
@@ -249,45 +450,113 @@ FindBestBoard_Rec_Channels::FindBestBoard_Rec_Channels(const uint& numWorkers)
 	//start all the coroutines
 	for(uint i = 0; i < numWorkers; i++)
 	{
-		workers.push_back(async([this](){
-			for(;;)
+		workers.push_back(async([this, i](){
+			Trace::SetThreadName("search worker " + to_string(i));
+			SearchJob job;
+			while(argsChan.pop(job) == boost::fibers::channel_op_status::success)
 			{
-				auto args = argsChan.value_pop();
-				Board& localBoard = get<0>(args);
-				TetriminoRotation& tr = get<1>(args);
-				deque<int>& tetriminoQueue = get<2>(args);
-
-				Board best;
-				localBoard.DropAndUpdateScore(tr, [&tetriminoQueue, &best, &localBoard](const int& destroyedLines, const int& dropHeight, const TetriminoRotation& tr){
-					localBoard.ResursiveScoreCalculator(destroyedLines, dropHeight, tr, best, tetriminoQueue);
-				});
-				resultChan.push(best);
+				if(job.speculation)
+				{
+					Trace::Scope scope("SpeculationSubtree", job.childIndex);
+					job.speculation->Score(job.childIndex);
+					//else a cancelled speculation stays alive until this worker gets its next job
+					job.speculation.reset();
+					continue;
+				}
+
+				Trace::Scope scope("Subtree", job.childIndex);
+				SearchNode& child = tree.RootChildren()[job.childIndex];
+				score_t score = tree.Evaluate(child, child.consumed, searchQueue);
+				resultChan.push(make_pair(job.childIndex, score));
 			}
 		}));
 	}
 }
 
-Board FindBestBoard_Rec_Channels::operator()(const Board& board, const deque<int>& tetriminoQueue)
+FindBestBoard_Rec_Channels::~FindBestBoard_Rec_Channels()
 {
-	uint workloadSize = 0;
+	argsChan.close();
+	for(auto& worker : workers)
+	{
+		worker.wait();
+	}
+}
 
-	Helpers::ForEachTrPos(Game::tetriminos[tetriminoQueue[0]], [this, &board, &tetriminoQueue, &workloadSize](const TetriminoRotation& tr){
-		Board localBoard(board);
-		workloadSize++;
-		argsChan.push(make_tuple(localBoard, tr, tetriminoQueue));
-	});
+SearchResult FindBestBoard_Rec_Channels::operator()(const Board& board, const int& hold, const deque<int>& tetriminoQueue,
+	const function<void(const vector<SearchNode>&)>& onCandidates)
+{
+	searchQueue = tetriminoQueue;
+	{
+		Trace::Scope scope("Prepare");
+		tree.Prepare(board, hold, tetriminoQueue);
+	}
 
-	uint numResults = 0;
+	vector<SearchNode>& children = tree.RootChildren();
+	{
+		Trace::Scope scope("Dispatch", children.size());
+		for(size_t i = 0; i < children.size(); i++)
+		{
+			argsChan.push(SearchJob{i, nullptr});
+		}
+	}
 
-	Board best;
-	for(auto& result: resultChan)
+	size_t numResults = 0;
+	size_t bestIndex = 0;
+	size_t speculateAt = max<size_t>(1, children.size() * SPECULATION_START);
+	vector<pair<score_t, size_t>> scores;
+	SearchResult best;
+
+	Trace::Scope reduceScope("Reduce");
+	if(!children.empty())
 	{
-		if(result.score > best.score)
-			best = move(result);
+		for(auto& result: resultChan)
+		{
+			if(onCandidates)
+			{
+				scores.emplace_back(result.second, result.first);
+				if(scores.size() == speculateAt)
+					onCandidates(tree.TopChildren(scores, SPECULATION_WIDTH));
+			}
 
-		if(++numResults >= workloadSize)
-			break;
+			if(SearchTree::IsBetter(result.second, result.first, best.board.score, bestIndex))
+			{
+				best = tree.Result(result.first, result.second);
+				bestIndex = result.first;
+			}
+
+			if(++numResults >= children.size())
+				break;
+		}
 	}
 
+	if(Board::IsPlayable(best.board.score))
+		tree.Retain(bestIndex);
+	else
+		best.board.score = SCORE_GAME_OVER;
+
 	return best;
+}
+
+void FindBestBoard_Rec_Channels::Dispatch(const shared_ptr<Speculation>& speculation)
+{
+	Trace::Scope scope("DispatchSpeculation", speculation->tree.Root().children.size());
+	for(size_t i = 0; i < speculation->tree.Root().children.size(); i++)
+	{
+		argsChan.push(SearchJob{i, speculation});
+	}
+}
+
+void FindBestBoard_Rec_Channels::Adopt(SearchTree&& tree)
+{
+	this->tree = move(tree);
+}
+
+const SearchTree& FindBestBoard_Rec_Channels::Tree() const
+{
+	return tree;
+}
+
+void FindBestBoard_Rec_Channels::SetEvaluator(const string& name)
+{
+	tree.SetEvaluator(name);
 }
\ No newline at end of file
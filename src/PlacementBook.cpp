@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PlacementBook.h"
+#include "Game.h"
+
+using namespace std;
+
+static_assert(BOOK_ROWS * BLOCKS_W + 3 + 3 * LOOK_AHEAD <= 64, "book key doesn't fit in 64 bits");
+static_assert(BOOK_RESULT_ROWS <= BLOCKS_H, "BOOK_ROWS too high for the board");
+
+const char PlacementBook::magic[8] = {'T', 'B', 'B', 'O', 'O', 'K', '2', '\0'};
+
+PlacementBook::PlacementBook()
+{
+	fd = -1;
+	mappedSize = 0;
+	mapped = nullptr;
+	entries = nullptr;
+	numEntries = 0;
+}
+
+PlacementBook::~PlacementBook()
+{
+	if(mapped)
+		munmap(const_cast<void*>(mapped), mappedSize);
+	if(fd >= 0)
+		close(fd);
+}
+
+void PlacementBook::Open(const string& fileName, const string& evaluator)
+{
+	fd = open(fileName.c_str(), O_RDONLY);
+	if(fd < 0)
+		Game::Fatal("Cannot open book: " + fileName);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader))
+		Game::Fatal("Book too small: " + fileName);
+
+	mappedSize = st.st_size;
+	mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+	if(mapped == MAP_FAILED)
+		Game::Fatal("Cannot map book: " + fileName);
+
+	const BookHeader* header = static_cast<const BookHeader*>(mapped);
+	if(memcmp(header->magic, magic, sizeof(magic)) != 0)
+		Game::Fatal("Not a book: " + fileName);
+
+	if(header->blocksW != BLOCKS_W || header->blocksH != BLOCKS_H || header->bookRows != BOOK_ROWS || header->lookAhead != LOOK_AHEAD)
+		Game::Fatal("Book built with other constants: " + fileName);
+
+	if(string(header->evaluator, strnlen(header->evaluator, sizeof(header->evaluator))) != evaluator)
+		Game::Fatal("Book built for evaluator " + string(header->evaluator) + ": " + fileName);
+
+	if(sizeof(BookHeader) + header->numEntries * sizeof(BookEntry) > mappedSize)
+		Game::Fatal("Truncated book: " + fileName);
+
+	entries = reinterpret_cast<const BookEntry*>(static_cast<const char*>(mapped) + sizeof(BookHeader));
+	numEntries = header->numEntries;
+
+	madvise(const_cast<void*>(mapped), mappedSize, MADV_RANDOM);
+}
+
+bool PlacementBook::IsOpen() const
+{
+	return entries != nullptr;
+}
+
+size_t PlacementBook::Size() const
+{
+	return numEntries;
+}
+
+bool PlacementBook::Key(const Board& board, const int& hold, const deque<int>& tetriminoQueue, uint64_t& key)
+{
+	for(int i = BOOK_ROWS; i < BLOCKS_H; i++)
+	{
+		if(board.boardArr[i])
+			return false;
+	}
+
+	key = 0;
+	for(int i = 0; i < BOOK_ROWS; i++)
+	{
+		key = (key << BLOCKS_W) | (board.boardArr[i] >> (MAX_WIDTH - BLOCKS_W));
+	}
+
+	key = (key << 3) | (uint64_t)(hold + 1);
+	for(int i = 0; i < LOOK_AHEAD; i++)
+	{
+		key = (key << 3) | (uint64_t)tetriminoQueue[i];
+	}
+	return true;
+}
+
+bool PlacementBook::Find(const Board& board, const int& hold, const deque<int>& tetriminoQueue, SearchResult& result) const
+{
+	uint64_t key;
+	if(!IsOpen() || !Key(board, hold, tetriminoQueue, key))
+		return false;
+
+	const BookEntry* end = entries + numEntries;
+	const BookEntry* entry = lower_bound(entries, end, key, [](const BookEntry& e, const uint64_t& k){return e.key < k;});
+	if(entry == end || entry->key != key)
+		return false;
+
+	result.board = Board();
+	for(int i = 0; i < BOOK_RESULT_ROWS; i++)
+	{
+		result.board.boardArr[i] = (WidthInt)entry->rows[i] << (MAX_WIDTH - BLOCKS_W);
+	}
+	result.board.score = entry->score;
+
+	if(entry->swapped)
+	{
+		result.consumed = hold < 0 ? 2 : 1;
+		result.hold = tetriminoQueue[0];
+	}
+	else
+	{
+		result.consumed = 1;
+		result.hold = hold;
+	}
+	return true;
+}
+
+bool PlacementBook::MakeEntry(const Board& board, const int& hold, const deque<int>& tetriminoQueue, const SearchResult& result, BookEntry& entry)
+{
+	if(!Board::IsPlayable(result.board.score) || !Key(board, hold, tetriminoQueue, entry.key))
+		return false;
+
+	for(int i = BOOK_RESULT_ROWS; i < BLOCKS_H; i++)
+	{
+		if(result.board.boardArr[i])
+			return false;
+	}
+
+	for(int i = 0; i < BOOK_RESULT_ROWS; i++)
+	{
+		entry.rows[i] = result.board.boardArr[i] >> (MAX_WIDTH - BLOCKS_W);
+	}
+	entry.score = result.board.score;
+	entry.swapped = result.consumed == 2 || result.hold != hold;
+	return true;
+}
+
+namespace
+{
+	struct BookPosition
+	{
+		Board board;
+		int hold;
+		deque<int> tetriminoQueue;
+	};
+
+	//every queue made of prefix followed by count pieces
+	void AppendQueues(const deque<int>& prefix, const int& count, vector<deque<int>>& queues)
+	{
+		if(count == 0)
+		{
+			queues.push_back(prefix);
+			return;
+		}
+
+		for(int piece = 0; piece < NUM_PIECES; piece++)
+		{
+			deque<int> queue(prefix);
+			queue.push_back(piece);
+			AppendQueues(queue, count - 1, queues);
+		}
+	}
+}
+
+vector<BookEntry> PlacementBook::Generate(const string& evaluator)
+{
+	FindBestBoard_Rec_Channels search(NUM_WORKERS);
+	search.SetEvaluator(evaluator);
+
+	vector<deque<int>> queues;
+	AppendQueues(deque<int>(), LOOK_AHEAD, queues);
+
+	vector<BookPosition> positions;
+	for(auto& queue : queues)
+	{
+		positions.push_back(BookPosition{Board(), -1, move(queue)});
+	}
+
+	vector<BookEntry> entries;
+	unordered_set<uint64_t> seen;
+	for(int depth = 0; depth < BOOK_DEPTH && !positions.empty(); depth++)
+	{
+		cout << "Book move " << depth + 1 << ": " << positions.size() << " positions" << endl;
+
+		vector<BookPosition> next;
+		for(const BookPosition& position : positions)
+		{
+			SearchResult result = search(position.board, position.hold, position.tetriminoQueue);
+			BookEntry entry;
+			if(!MakeEntry(position.board, position.hold, position.tetriminoQueue, result, entry))
+				continue;
+			entries.push_back(entry);
+
+			if(depth + 1 == BOOK_DEPTH)
+				continue;
+
+			//the pieces used by the placement leave the queue, any pieces can replace them
+			queues.clear();
+			deque<int> rest(position.tetriminoQueue.begin() + result.consumed, position.tetriminoQueue.end());
+			AppendQueues(rest, result.consumed, queues);
+			for(auto& queue : queues)
+			{
+				uint64_t key;
+				if(Key(result.board, result.hold, queue, key) && seen.insert(key).second)
+					next.push_back(BookPosition{result.board, result.hold, move(queue)});
+			}
+		}
+		positions = move(next);
+	}
+	return entries;
+}
+
+size_t PlacementBook::Write(const string& fileName, const string& evaluator, vector<BookEntry> entries)
+{
+	stable_sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b){return a.key < b.key;});
+	entries.erase(unique(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b){return a.key == b.key;}), entries.end());
+
+	BookHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.blocksW = BLOCKS_W;
+	header.blocksH = BLOCKS_H;
+	header.bookRows = BOOK_ROWS;
+	header.lookAhead = LOOK_AHEAD;
+	strncpy(header.evaluator, evaluator.c_str(), sizeof(header.evaluator) - 1);
+	header.numEntries = entries.size();
+
+	string tmpName = fileName + ".tmp";
+	ofstream file(tmpName, ios::binary | ios::trunc);
+	if(!file.is_open())
+		Game::Fatal("Cannot write book: " + tmpName);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BookEntry));
+	file.close();
+	if(!file)
+		Game::Fatal("Failed writing book: " + tmpName);
+
+	if(rename(tmpName.c_str(), fileName.c_str()) != 0)
+		Game::Fatal("Cannot rename book to " + fileName);
+
+	return entries.size();
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <sstream>
+
+#include "RolloutSearch.h"
+#include "Game.h"
+#include "Trace.h"
+
+using namespace std;
+
+RolloutSearch::RolloutSearch(const uint& numWorkers, const uint64_t& seed) : seeder(seed)
+{
+	for(uint i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(async(launch::async, [this, i](){
+			Trace::SetThreadName("rollout worker " + to_string(i));
+			Job job;
+			while(argsChan.pop(job) == boost::fibers::channel_op_status::success)
+			{
+				Trace::Scope scope("Playouts", job.childIndex);
+				const SearchNode& child = tree.RootChildren()[job.childIndex];
+				resultChan.push(make_pair(job.childIndex, Playouts(child, job.playouts, job.seed)));
+			}
+		}));
+	}
+}
+
+RolloutSearch::~RolloutSearch()
+{
+	argsChan.close();
+	for(auto& worker : workers)
+	{
+		worker.wait();
+	}
+}
+
+string RolloutSearch::RngState() const
+{
+	ostringstream out;
+	out << seeder;
+	return out.str();
+}
+
+void RolloutSearch::SetRngState(const string& state)
+{
+	istringstream in(state);
+	if(!(in >> seeder))
+		Game::Fatal("Bad rollout generator state");
+}
+
+RolloutStats RolloutSearch::Playouts(const SearchNode& child, const uint64_t& playouts, const uint64_t& seed) const
+{
+	mt19937 rng(seed);
+	uniform_int_distribution<int> dist(0, NUM_PIECES - 1);
+	RolloutStats stats;
+	PlacementBatch batch;
+
+	for(uint64_t p = 0; p < playouts; p++)
+	{
+		Board board = child.board;
+		score_t score = board.CalculateScore(child.destroyedLines, child.dropHeight, child.trHeight);
+		bool alive = true;
+		stats.lines += child.destroyedLines;
+
+		for(int depth = 0; depth < ROLLOUT_DEPTH && alive; depth++)
+		{
+			size_t queueIndex = child.consumed + depth;
+			int tetrimino = queueIndex < searchQueue.size() ? searchQueue[queueIndex] : dist(rng);
+
+			board.Placements(Game::tetriminos[tetrimino], batch);
+			score_t bestScore = SCORE_INVALID;
+			size_t bestIndex = 0;
+			for(size_t i = 0; i < batch.size; i++)
+			{
+				score_t placedScore = batch.boards[i].CalculateScore(batch.destroyedLines[i], batch.dropHeights[i], batch.trHeights[i]);
+				if(placedScore > bestScore)
+				{
+					bestScore = placedScore;
+					bestIndex = i;
+				}
+			}
+
+			alive = Board::IsPlayable(bestScore);
+			if(alive)
+			{
+				board = batch.boards[bestIndex];
+				board.score = bestScore;
+				score = bestScore;
+				stats.lines += batch.destroyedLines[bestIndex];
+			}
+		}
+
+		stats.playouts++;
+		if(alive)
+		{
+			stats.survived++;
+			stats.scoreSum += score;
+		}
+		else
+		{
+			stats.scoreSum += ROLLOUT_DEATH_SCORE;
+		}
+	}
+
+	return stats;
+}
+
+SearchResult RolloutSearch::operator()(const Board& board, const int& hold, const deque<int>& tetriminoQueue)
+{
+	searchQueue = tetriminoQueue;
+	tree.Prepare(board, hold, tetriminoQueue);
+
+	vector<SearchNode>& children = tree.RootChildren();
+	SearchResult best;
+	if(children.empty())
+	{
+		best.board.score = SCORE_GAME_OVER;
+		return best;
+	}
+
+	uint64_t playoutsPerChild = max<uint64_t>(1, ROLLOUT_BUDGET / children.size());
+	{
+		Trace::Scope scope("Dispatch", children.size());
+		for(size_t i = 0; i < children.size(); i++)
+		{
+			argsChan.push(Job{i, playoutsPerChild, seeder()});
+		}
+	}
+
+	Trace::Scope reduceScope("Reduce");
+	size_t bestIndex = 0;
+	RolloutStats bestStats;
+	size_t numResults = 0;
+	for(auto& result : resultChan)
+	{
+		const RolloutStats& stats = result.second;
+		if(numResults == 0 || IsBetter(stats, result.first, bestStats, bestIndex))
+		{
+			bestStats = stats;
+			bestIndex = result.first;
+		}
+
+		if(++numResults >= children.size())
+			break;
+	}
+
+	chosen.playouts += bestStats.playouts;
+	chosen.survived += bestStats.survived;
+	chosen.lines += bestStats.lines;
+	chosen.scoreSum += bestStats.scoreSum;
+
+	//the played board gets its static score like in the lookahead search, the playout scores only stay in the stats
+	const SearchNode& child = children[bestIndex];
+	return tree.Result(bestIndex, child.board.CalculateScore(child.destroyedLines, child.dropHeight, child.trHeight));
+}
+
+score_t RolloutSearch::Mean(const RolloutStats& stats)
+{
+	return stats.scoreSum / (int64_t)stats.playouts;
+}
+
+bool RolloutSearch::IsBetter(const RolloutStats& stats, const size_t& index, const RolloutStats& best, const size_t& bestIndex)
+{
+	//survival rates compared without dividing
+	uint64_t survival = stats.survived * best.playouts;
+	uint64_t bestSurvival = best.survived * stats.playouts;
+	if(survival != bestSurvival)
+		return survival > bestSurvival;
+
+	return SearchTree::IsBetter(Mean(stats), index, Mean(best), bestIndex);
+}
+
+const RolloutStats& RolloutSearch::Chosen() const
+{
+	return chosen;
+}
+
+void RolloutSearch::SetChosen(const RolloutStats& stats)
+{
+	chosen = stats;
+}
\ No newline at end of file
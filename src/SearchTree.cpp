@@ -0,0 +1,277 @@
+#include <algorithm>
+
+#include "SearchTree.h"
+#include "Game.h"
+#include "Evaluator.h"
+
+using namespace std;
+
+bool TranspositionTable::Find(const pair<Board, int>& key, score_t& score)
+{
+	size_t shard = CacheHash()(key) % numShards;
+	lock_guard<mutex> lock(locks[shard]);
+
+	auto it = shards[shard].find(key);
+	if(it == shards[shard].end())
+		return false;
+
+	score = it->second;
+	return true;
+}
+
+void TranspositionTable::Insert(const pair<Board, int>& key, const score_t& score)
+{
+	size_t shard = CacheHash()(key) % numShards;
+	lock_guard<mutex> lock(locks[shard]);
+	shards[shard][key] = score;
+}
+
+void TranspositionTable::Clear()
+{
+	for(size_t i = 0; i < numShards; i++)
+	{
+		lock_guard<mutex> lock(locks[i]);
+		shards[i].clear();
+	}
+}
+
+const vector<EvaluatorEntry> SearchTree::evaluators = {
+	{"el-tetris", &SearchTree::EvaluateWith<DefaultEvaluator>},
+	{"no-wells", &SearchTree::EvaluateWith<NoWellsEvaluator>},
+	{"fast", &SearchTree::EvaluateWith<FastEvaluator>},
+};
+
+SearchTree::SearchTree()
+{
+	evaluate = evaluators.front().evaluate;
+}
+
+void SearchTree::SetEvaluator(const string& name)
+{
+	auto entry = find_if(evaluators.begin(), evaluators.end(), [&name](const EvaluatorEntry& e){return e.name == name;});
+	if(entry == evaluators.end())
+		Game::Fatal("Unknown evaluator: " + name);
+
+	evaluate = entry->evaluate;
+}
+
+void SearchTree::AddPlacements(SearchNode& node, const int& tetriminoIndex, const int& hold, const int& consumed)
+{
+	//one per worker thread, reused for every node it expands
+	thread_local PlacementBatch batch;
+	node.board.Placements(Game::tetriminos[tetriminoIndex], batch);
+
+	size_t first = node.children.size();
+	node.children.resize(first + batch.size);
+	for(size_t i = 0; i < batch.size; i++)
+	{
+		SearchNode& child = node.children[first + i];
+		child.board = batch.boards[i];
+		child.hold = hold;
+		child.consumed = consumed;
+		child.destroyedLines = batch.destroyedLines[i];
+		child.dropHeight = batch.dropHeights[i];
+		child.trHeight = batch.trHeights[i];
+	}
+}
+
+bool SearchTree::HoldPlacement(const SearchNode& node, const int& queueIndex, const deque<int>& tetriminoQueue, int& piece, int& consumed)
+{
+	//holding the same piece would only repeat the placements of the current one
+	if(node.hold == tetriminoQueue[queueIndex])
+		return false;
+
+	if(node.hold >= 0)
+	{
+		piece = node.hold;
+		consumed = 1;
+		return true;
+	}
+
+	if(queueIndex + 1 >= (int)tetriminoQueue.size())
+		return false;
+	piece = tetriminoQueue[queueIndex + 1];
+	consumed = 2;
+	return true;
+}
+
+void SearchTree::Expand(SearchNode& node, const int& queueIndex, const deque<int>& tetriminoQueue, const bool& leaves)
+{
+	int size = tetriminoQueue.size();
+	int current = tetriminoQueue[queueIndex];
+	if(!node.expanded && (leaves || queueIndex + 1 < size))
+	{
+		AddPlacements(node, current, node.hold, 1);
+		node.expanded = true;
+	}
+
+	//the hold placements use as many pieces as the current ones or more, so they never become leaves first
+	int piece, consumed;
+	if(node.holdExpanded || !HoldPlacement(node, queueIndex, tetriminoQueue, piece, consumed))
+		return;
+
+	if(leaves || queueIndex + consumed < size)
+	{
+		AddPlacements(node, piece, current, consumed);
+		node.holdExpanded = true;
+	}
+}
+
+void SearchTree::Prepare(const Board& board, const int& hold, const deque<int>& tetriminoQueue)
+{
+	bool reusable = root.board == board && root.hold == hold && expandedQueue.size() <= tetriminoQueue.size()
+		&& equal(expandedQueue.begin(), expandedQueue.end(), tetriminoQueue.begin());
+
+	if(!reusable)
+	{
+		root = SearchNode();
+		root.board = board;
+		root.hold = hold;
+		expandedQueue.clear();
+	}
+
+	//the root keeps its leaves, they are the moves to choose from
+	Expand(root, 0, tetriminoQueue, true);
+
+	//levels not expanded yet get expanded during the search with the pieces just revealed
+	expandedQueue.assign(tetriminoQueue.begin(), tetriminoQueue.end());
+	//scores depend on the whole queue so they can't be kept between moves
+	table->Clear();
+}
+
+vector<SearchNode>& SearchTree::RootChildren()
+{
+	return root.children;
+}
+
+const SearchNode& SearchTree::Root() const
+{
+	return root;
+}
+
+const deque<int>& SearchTree::ExpandedQueue() const
+{
+	return expandedQueue;
+}
+
+void SearchTree::Retain(const size_t& childIndex)
+{
+	SearchNode chosen = move(root.children[childIndex]);
+	root = move(chosen);
+	for(int i = 0; i < root.consumed && !expandedQueue.empty(); i++)
+	{
+		expandedQueue.pop_front();
+	}
+}
+
+void SearchTree::Adopt(SearchNode&& node, const deque<int>& expandedQueue)
+{
+	root = move(node);
+	this->expandedQueue = expandedQueue;
+}
+
+vector<SearchNode> SearchTree::TopChildren(vector<pair<score_t, size_t>> scores, const size_t& count) const
+{
+	size_t numTop = min(count, scores.size());
+	partial_sort(scores.begin(), scores.begin() + numTop, scores.end(), [](auto a, auto b){return IsBetter(a.first, a.second, b.first, b.second);});
+
+	vector<SearchNode> top;
+	for(size_t i = 0; i < numTop && Board::IsPlayable(scores[i].first); i++)
+	{
+		top.push_back(root.children[scores[i].second]);
+		top.back().board.score = scores[i].first;
+	}
+	return top;
+}
+
+SearchResult SearchTree::Result(const size_t& childIndex, const score_t& score) const
+{
+	const SearchNode& child = root.children[childIndex];
+
+	SearchResult result;
+	result.board = child.board;
+	result.board.score = score;
+	result.hold = child.hold;
+	result.consumed = child.consumed;
+	return result;
+}
+
+SearchResult SearchTree::Choose(const vector<pair<score_t, size_t>>& scores)
+{
+	SearchResult best;
+	size_t bestIndex = 0;
+	for(const auto& score : scores)
+	{
+		if(IsBetter(score.first, score.second, best.board.score, bestIndex))
+		{
+			best = Result(score.second, score.first);
+			bestIndex = score.second;
+		}
+	}
+
+	if(Board::IsPlayable(best.board.score))
+		Retain(bestIndex);
+	else
+		best.board.score = SCORE_GAME_OVER;
+
+	return best;
+}
+
+bool SearchTree::IsBetter(const score_t& score, const size_t& index, const score_t& bestScore, const size_t& bestIndex)
+{
+	return score > bestScore || (score == bestScore && index < bestIndex);
+}
+
+template <typename Evaluator>
+score_t SearchTree::BestLeaf(const Board& board, const int& tetriminoIndex)
+{
+	//separate from the one of AddPlacements, a node can be expanded and have its leaves scored in turn
+	thread_local PlacementBatch batch;
+	board.Placements(Game::tetriminos[tetriminoIndex], batch);
+
+	score_t best = SCORE_GAME_OVER;
+	for(size_t i = 0; i < batch.size; i++)
+	{
+		score_t score = Evaluator::Score(batch.boards[i], batch.destroyedLines[i], batch.dropHeights[i], batch.trHeights[i]);
+		if(score > best)
+			best = score;
+	}
+	return best;
+}
+
+template <typename Evaluator>
+score_t SearchTree::EvaluateWith(SearchNode& node, const int& queueIndex, const deque<int>& tetriminoQueue)
+{
+	if(queueIndex >= (int)tetriminoQueue.size())
+		return Evaluator::Score(node.board, node.destroyedLines, node.dropHeight, node.trHeight);
+
+	pair<Board, int> key(node.board, queueIndex * (NUM_PIECES + 1) + node.hold + 1);
+	score_t best;
+	if(table->Find(key, best))
+		return best;
+
+	Expand(node, queueIndex, tetriminoQueue, false);
+
+	best = SCORE_GAME_OVER;
+	for(auto& child : node.children)
+	{
+		score_t score = EvaluateWith<Evaluator>(child, queueIndex + child.consumed, tetriminoQueue);
+		if(score > best)
+			best = score;
+	}
+
+	//placements that weren't added are leaves
+	int piece, consumed;
+	if(!node.expanded)
+		best = max(best, BestLeaf<Evaluator>(node.board, tetriminoQueue[queueIndex]));
+	if(!node.holdExpanded && HoldPlacement(node, queueIndex, tetriminoQueue, piece, consumed))
+		best = max(best, BestLeaf<Evaluator>(node.board, piece));
+
+	table->Insert(key, best);
+	return best;
+}
+
+score_t SearchTree::Evaluate(SearchNode& node, const int& queueIndex, const deque<int>& tetriminoQueue)
+{
+	return (this->*evaluate)(node, queueIndex, tetriminoQueue);
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "SpeculativeSearch.h"
+#include "Game.h"
+#include "Trace.h"
+
+using namespace std;
+
+void Speculation::Score(const size_t& childIndex)
+{
+	score_t score = SCORE_INVALID;
+	if(!cancelled)
+	{
+		SearchNode& child = tree.RootChildren()[childIndex];
+		score = tree.Evaluate(child, child.consumed, tetriminoQueue);
+	}
+
+	lock_guard<mutex> guard(lock);
+	scores.emplace_back(score, childIndex);
+	done.notify_all();
+}
+
+vector<pair<score_t, size_t>> Speculation::Wait(const size_t& count)
+{
+	unique_lock<mutex> guard(lock);
+	done.wait(guard, [this, count](){return scores.size() >= count;});
+	return scores;
+}
+
+SpeculativeSearch::~SpeculativeSearch()
+{
+	Cancel();
+}
+
+void SpeculativeSearch::Launch(const vector<SearchNode>& candidates, const deque<int>& parentQueue, const deque<int>& nextQueue,
+	const string& evaluator, FindBestBoard_Rec_Channels& search)
+{
+	Cancel();
+
+	speculatedQueue = nextQueue;
+	deque<int> expandedQueue(parentQueue.begin() + 1, parentQueue.end());
+
+	for(const auto& candidate : candidates)
+	{
+		//filling an empty hold slot uses two pieces, so the next queue isn't nextQueue
+		if(candidate.consumed != 1)
+			continue;
+
+		auto speculation = make_shared<Speculation>();
+		speculation->board = candidate.board;
+		speculation->hold = candidate.hold;
+		speculation->tetriminoQueue = nextQueue;
+		speculation->tree.SetEvaluator(evaluator);
+		speculation->tree.Adopt(SearchNode(candidate), expandedQueue);
+		speculation->tree.Prepare(candidate.board, candidate.hold, nextQueue);
+
+		search.Dispatch(speculation);
+		speculations.push_back(move(speculation));
+	}
+}
+
+bool SpeculativeSearch::Take(const Board& board, const int& hold, const deque<int>& tetriminoQueue, SpeculationResult& result,
+	const function<void(const vector<SearchNode>&)>& onCandidates)
+{
+	auto hit = speculatedQueue == tetriminoQueue
+		? find_if(speculations.begin(), speculations.end(), [&board, hold](const shared_ptr<Speculation>& s){return s->board == board && s->hold == hold;})
+		: speculations.end();
+
+	if(hit == speculations.end())
+	{
+		Cancel();
+		return false;
+	}
+
+	shared_ptr<Speculation> speculation = move(*hit);
+	speculations.erase(hit);
+	Cancel();
+
+	//scored root children are never touched by the workers again, so the best ones can be copied while the others are searched
+	size_t numChildren = speculation->tree.Root().children.size();
+	if(numChildren > 0)
+	{
+		vector<pair<score_t, size_t>> scores;
+		{
+			Trace::Scope scope("WaitCandidates");
+			scores = speculation->Wait(max<size_t>(1, numChildren * SPECULATION_START));
+		}
+		onCandidates(speculation->tree.TopChildren(scores, SPECULATION_WIDTH));
+	}
+
+	vector<pair<score_t, size_t>> scores;
+	{
+		Trace::Scope scope("WaitSpeculation");
+		scores = speculation->Wait(numChildren);
+	}
+
+	//no worker touches the tree once its last root child is scored
+	result.best = speculation->tree.Choose(scores);
+	result.tree = move(speculation->tree);
+	return true;
+}
+
+void SpeculativeSearch::Keep(const Board& board, const int& hold)
+{
+	for(auto& speculation : speculations)
+	{
+		if(!(speculation->board == board && speculation->hold == hold))
+			speculation->cancelled = true;
+	}
+	speculations.erase(remove_if(speculations.begin(), speculations.end(), [](const shared_ptr<Speculation>& s){return s->cancelled.load();}),
+		speculations.end());
+}
+
+void SpeculativeSearch::Cancel()
+{
+	//trees are freed by the worker dropping their last queued root child
+	for(auto& speculation : speculations)
+	{
+		speculation->cancelled = true;
+	}
+	speculations.clear();
+}
\ No newline at end of file
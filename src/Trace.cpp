@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Trace.h"
+#include "Game.h"
+
+using namespace std;
+
+namespace
+{
+	struct Event
+	{
+		const char* name;
+		int64_t arg;
+		int64_t start;
+		int64_t end;
+	};
+
+	//only its own thread appends, the lock is there for Write
+	struct ThreadBuffer
+	{
+		mutex lock;
+		int tid;
+		string name;
+		vector<Event> events;
+	};
+
+	const auto epoch = chrono::steady_clock::now();
+	mutex buffersLock;
+	vector<shared_ptr<ThreadBuffer>> buffers;
+	int lastTid = 0;
+
+	//registers the buffer of its thread on first use, when the thread ends the buffer is dropped if it recorded nothing
+	//and its spare capacity is given back otherwise
+	struct LocalHandle
+	{
+		shared_ptr<ThreadBuffer> buffer;
+
+		~LocalHandle()
+		{
+			if(!buffer)
+				return;
+
+			lock_guard<mutex> lock(buffersLock);
+			lock_guard<mutex> bufferLock(buffer->lock);
+			if(buffer->events.empty())
+				buffers.erase(remove(buffers.begin(), buffers.end(), buffer), buffers.end());
+			else
+				buffer->events.shrink_to_fit();
+		}
+	};
+
+	ThreadBuffer& LocalBuffer()
+	{
+		thread_local LocalHandle handle;
+		if(!handle.buffer)
+		{
+			handle.buffer = make_shared<ThreadBuffer>();
+			handle.buffer->events.reserve(4096);
+
+			lock_guard<mutex> lock(buffersLock);
+			handle.buffer->tid = ++lastTid;
+			handle.buffer->name = "thread " + to_string(handle.buffer->tid);
+			buffers.push_back(handle.buffer);
+		}
+		return *handle.buffer;
+	}
+
+	string Escape(const string& s)
+	{
+		string out;
+		for(char c : s)
+		{
+			if(c == '"' || c == '\\')
+				out += '\\';
+			out += c;
+		}
+		return out;
+	}
+}
+
+atomic<bool> Trace::enabled{false};
+
+void Trace::Enable()
+{
+	enabled = true;
+}
+
+int64_t Trace::Now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::Record(const char* name, const int64_t& arg, const int64_t& start, const int64_t& end)
+{
+	ThreadBuffer& buffer = LocalBuffer();
+	lock_guard<mutex> lock(buffer.lock);
+	buffer.events.push_back(Event{name, arg, start, end});
+}
+
+void Trace::SetThreadName(const string& name)
+{
+	if(!IsEnabled())
+		return;
+
+	ThreadBuffer& buffer = LocalBuffer();
+	lock_guard<mutex> lock(buffer.lock);
+	buffer.name = name;
+}
+
+void Trace::Write(const string& fileName)
+{
+	ofstream file(fileName, ios::trunc);
+	if(!file.is_open())
+		Game::Fatal("Cannot write trace: " + fileName);
+
+	Write(file);
+	file.close();
+	if(!file)
+		Game::Fatal("Failed writing trace: " + fileName);
+}
+
+void Trace::Write(ostream& out)
+{
+	out << fixed << setprecision(3) << "{\"traceEvents\":[";
+	bool first = true;
+
+	lock_guard<mutex> lock(buffersLock);
+	for(auto& buffer : buffers)
+	{
+		lock_guard<mutex> bufferLock(buffer->lock);
+
+		out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+			<< ",\"args\":{\"name\":\"" << Escape(buffer->name) << "\"}}";
+		first = false;
+
+		for(const Event& event : buffer->events)
+		{
+			out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0;
+			if(event.arg >= 0)
+				out << ",\"args\":{\"value\":" << event.arg << "}";
+			out << "}";
+		}
+	}
+
+	out << "\n]}\n";
+}
+
+void Trace::Clear()
+{
+	lock_guard<mutex> lock(buffersLock);
+	//a buffer only referenced from here belongs to a thread that ended
+	buffers.erase(remove_if(buffers.begin(), buffers.end(), [](const shared_ptr<ThreadBuffer>& buffer){return buffer.use_count() == 1;}), buffers.end());
+	for(auto& buffer : buffers)
+	{
+		lock_guard<mutex> bufferLock(buffer->lock);
+		buffer->events.clear();
+	}
+}
\ No newline at end of file
@@ -2,19 +2,133 @@
 #include <math.h>
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include "Game.h"
+#include "PlacementBook.h"
+#include "Trace.h"
+#include "Farm.h"
 
 using namespace std;
 
-int main()
+int main(int argc, char* argv[])
 {
-    Game game;
+    GameOptions options;
+    uint64_t moves = 0;
+    string buildBook;
+    string traceFile;
+    bool farm = false;
+    uint farmWorkers = 0;
+    uint16_t farmPort = 0;
+    uint64_t games = 0;
 
-    for(;;)
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if(arg == "--pipelined")
+            options.pipelined = true;
+        else if(arg == "--evaluator" && i + 1 < argc)
+            options.evaluator = argv[++i];
+        else if(arg == "--book" && i + 1 < argc)
+            options.book = argv[++i];
+        else if(arg == "--build-book" && i + 1 < argc)
+            buildBook = argv[++i];
+        else if(arg == "--moves" && i + 1 < argc)
+            moves = stoull(argv[++i]);
+        else if(arg == "--seed" && i + 1 < argc)
+            options.seed = stoull(argv[++i]);
+        else if(arg == "--rollouts")
+            options.rollouts = true;
+        else if(arg == "--trace" && i + 1 < argc)
+            traceFile = argv[++i];
+        else if(arg == "--checkpoint" && i + 1 < argc)
+            options.checkpoint = argv[++i];
+        else if(arg == "--checkpoint-every" && i + 1 < argc)
+            options.checkpointEvery = stoull(argv[++i]);
+        else if(arg == "--resume" && i + 1 < argc)
+            options.resume = argv[++i];
+        else if(arg == "--farm" && i + 1 < argc)
+        {
+            farm = true;
+            farmWorkers = stoul(argv[++i]);
+        }
+        else if(arg == "--farm-port" && i + 1 < argc)
+            farmPort = stoul(argv[++i]);
+        else if(arg == "--farm-worker" && i + 1 < argc)
+        {
+            RunFarmWorker(argv[++i]);
+            return 0;
+        }
+        else if(arg == "--games" && i + 1 < argc)
+            games = stoull(argv[++i]);
+        else
+            Game::Fatal("Unknown argument: " + arg);
+    }
+
+    if(!traceFile.empty() && moves == 0)
+        Game::Fatal("--trace needs --moves");
+    if(options.rollouts && options.pipelined)
+        Game::Fatal("--pipelined only works with the lookahead search");
+    //book placements are lookahead decisions stored under the evaluator name, rollouts would read or write the wrong ones
+    if(options.rollouts && (!options.book.empty() || !buildBook.empty()))
+        Game::Fatal("--book and --build-book only work with the lookahead search");
+    if(options.checkpointEvery && options.checkpoint.empty())
+        Game::Fatal("--checkpoint-every needs --checkpoint");
+
+    if(farm)
+    {
+        if(moves == 0 || games == 0)
+            Game::Fatal("--farm needs --moves and --games");
+        if(!buildBook.empty() || !options.checkpoint.empty() || !options.resume.empty())
+            Game::Fatal("--farm doesn't build books or checkpoint");
+
+        FarmConfig config;
+        config.options = options;
+        config.moves = moves;
+        config.trace = !traceFile.empty();
+
+        FarmCoordinator coordinator(config, farmPort, traceFile);
+        vector<FarmResult> results = coordinator.Run(options.seed ? options.seed : 1, games, farmWorkers);
+
+        GameStatistics total;
+        for(const FarmResult& result : results)
+        {
+            const GameStatistics& statistics = result.statistics;
+            cout << "Seed " << result.seed << "  Deaths: " << statistics.deaths << "  Avg Score: " << statistics.totalScore / statistics.totalBlocks << endl;
+            total.deaths += statistics.deaths;
+            total.totalBlocks += statistics.totalBlocks;
+            total.totalScore += statistics.totalScore;
+        }
+        cout << "Games: " << results.size() << "  Blocks: " << total.totalBlocks << "  Deaths: " << total.deaths
+            << "  Avg Blocks Per Death: " << (total.deaths ? total.totalBlocks / double(total.deaths) : 0) << "  Avg Score: " << total.totalScore / total.totalBlocks << endl;
+        return 0;
+    }
+
+    if(!buildBook.empty())
+    {
+        size_t written = PlacementBook::Write(buildBook, options.evaluator, PlacementBook::Generate(options.evaluator));
+        cout << "Wrote " << written << " positions to " << buildBook << endl;
+        return 0;
+    }
+
+    if(!traceFile.empty())
+    {
+        Trace::Enable();
+        Trace::SetThreadName("main");
+    }
+
+    Game game(options);
+
+    for(uint64_t i = 0; moves == 0 || i < moves; i++)
     {
         game.Update();
     }
 
+    game.PrintStatistics();
+    game.SaveCheckpoint(true);
+
+    if(!traceFile.empty())
+        Trace::Write(traceFile);
+
     return 0;
-}
\ No newline at end of file
+}